@@ -2,6 +2,7 @@
 #include <cmath>
 #include <fstream>
 #include <vector>
+#include <cstring>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -13,6 +14,14 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "world.h"
+#include "record.h"
+#include "checksum.h"
+#include "kernels.h"
+#include "level.h"
+#include "jobs.h"
+#include "snapshot.h"
+
 using namespace std;
 
 struct VAO {
@@ -202,50 +211,28 @@ void draw3DObject (struct VAO* vao)
 	glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
 }
 
+/* Free the VBOs and VAO made by create3DObject */
+void delete3DObject (struct VAO* vao)
+{
+	glDeleteBuffers (1, &(vao->VertexBuffer));
+	glDeleteBuffers (1, &(vao->ColorBuffer));
+	glDeleteVertexArrays (1, &(vao->VertexArrayID));
+	delete vao;
+}
+
 /**************************
  * Customizable functions *
  **************************/
-typedef struct shape{
-
-	float trans_dir;
-	float rot_dir;
-	float rotation;
-	float trans;
-	float status;
-}shape ;
-shape trishape[10],rectshape[20];
-typedef struct mirshape{
-	float trans_x;
-	float trans_y;
-	float rot;
-	float x1;
-	float y1;
-	float x2;
-	float y2;
-}mirshape;
-mirshape mirror[5];
-typedef struct bulletshape{
-	float rad;
-	int status;
-	float angle;
-	float trans;
-	float newx;
-	float newy;
-	float nx;
-	float ny;
-}bulletshape;
-bulletshape bullet[20];
 float circle_rotation = 0;
 float semicircle_rotation=0;
-float brick_trans[20]={0},brick_status[20]={0},brick_x[20],brick_color[20];
-double current_time1,last_update_time1=glfwGetTime();
-double current_time2,last_update_time2=glfwGetTime();
-double mfire=glfwGetTime()-1;
-int rightkey=0,leftkey=0,rightctrl=0,rightalt=0;
-int spaceflag=0;int score=0;
-int bricks=0;
-float brick_increment=0.03;
-int zoom=0,flagmouse=0;float pan=0;
+World world;
+Recorder recorder;
+Trace trace;
+Level level;
+ThreadPool pool;
+Scheduler jobs;
+//sounds play here, off the frame's threads
+SerialQueue sounds;
 void* play_audio(string audioFile);
 
 void* play_audio(string audioFile){
@@ -294,259 +281,53 @@ void* play_audio(string audioFile){
 	mpg123_delete(mh);
 }
 
+/* Pass an input event to the simulation, recording it when --record is on */
+void input (int type, int code, int action, int mods, double x, double y)
+{
+	InputEvent ev;
+	ev.tick=world.tick;
+	ev.type=type;
+	ev.code=code;
+	ev.action=action;
+	ev.mods=mods;
+	ev.x=x;
+	ev.y=y;
+	recorder.write(ev);
+	apply_event(world,ev);
+}
+
 /* Executed when a regular key is pressed/released/held-down */
 /* Prefered for Keyboard events */
 void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	// Function is called first on GLFW_PRESS.
-	if (action == GLFW_RELEASE) {
-		if(key==GLFW_KEY_RIGHT )
-		{
-			rightkey=0;
-			rectshape[1].trans_dir=0;
-			rectshape[2].trans_dir=0;
-		}
-		if(key==GLFW_KEY_LEFT)
-		{
-			leftkey=0;
-			rectshape[1].trans_dir=0;
-			rectshape[2].trans_dir=0;
-		}
-		if(key==GLFW_KEY_RIGHT_CONTROL)
-		{
-			rightctrl=0;
-			rectshape[1].trans_dir=0;
-		}
-		if(key==GLFW_KEY_RIGHT_ALT)
-		{
-			rightalt=0;
-			rectshape[2].trans_dir=0;
-		}
-		switch (key) {
-			case GLFW_KEY_A:
-				rectshape[0].rot_dir = 0;
-				break;
-			case GLFW_KEY_D:
-				rectshape[0].rot_dir = 0;
-				break;
-			case GLFW_KEY_S:
-				rectshape[0].trans_dir = 0;
-				break;
-			case GLFW_KEY_F:
-				rectshape[0].trans_dir = 0;
-				break;
-			case GLFW_KEY_SPACE:
-				spaceflag=0;
-				break;
-			default:
-				break;
-		}
-	}
-	else if (action == GLFW_PRESS) {
-		flagmouse=0;
-		if(key==GLFW_KEY_RIGHT)
-			rightkey=1;
-		if(key==GLFW_KEY_LEFT)
-		{
-			leftkey=1;
-		}
-		if(key==GLFW_KEY_RIGHT_CONTROL)
-		{
-			rightctrl=1;
-		}
-		if(key==GLFW_KEY_RIGHT_ALT)
-		{
-			rightalt=1;
-		}
-		if(rightctrl==1 && rightkey==1)
-		{
-			rectshape[1].trans_dir=1;
-		}
-		if(rightctrl==1 && leftkey==1)
-		{
-			rectshape[1].trans_dir=-1;
-		}
-		if(rightkey==1 && rightalt==1)
-		{
-			rectshape[2].trans_dir=1;
-		}
-		if(leftkey==1 && rightalt==1)
-		{
-			rectshape[2].trans_dir=-1;
-		}
-		if(key==GLFW_KEY_UP && zoom<4){
-			zoom++;
-			flagmouse=1;
-		}
-		if(key==GLFW_KEY_DOWN && zoom){
-			zoom--;
-			flagmouse=1;
-		}
-		if(key==GLFW_KEY_LEFT && zoom){
-			pan++;
-			flagmouse=1;
-		}
-		if(key==GLFW_KEY_RIGHT && zoom){
-			pan--;
-			flagmouse=1;
-		}
-		if(flagmouse){
-			if(pan>zoom)
-				pan=zoom;
-			if(pan<-zoom)
-				pan=-zoom;
-			Matrices.projection = glm::ortho(-5.0f+zoom-pan, 5.0f-zoom-pan, -5.0f+zoom, 5.0f-zoom, 0.1f, 500.0f);
-		}
-		switch (key) {
-			case GLFW_KEY_ESCAPE:
-				quit(window);
-				break;
-			case GLFW_KEY_A:
-				rectshape[0].rot_dir = 1;
-				break;
-			case GLFW_KEY_D:
-				rectshape[0].rot_dir=-1;
-				break;
-			case GLFW_KEY_S:
-				rectshape[0].trans_dir=1;
-				break;
-			case GLFW_KEY_F:
-				rectshape[0].trans_dir=-1;
-				break;
-			case GLFW_KEY_SPACE:
-				//system("canberra-gtk-play -f /home/sathwik/Downloads/smb_fireball.wav");
-				spaceflag=1;
-				break;
-			case GLFW_KEY_N:
-				brick_increment+=0.02;
-				break;
-			case GLFW_KEY_M:
-				if(brick_increment-0.01>0.0)
-					brick_increment-=0.01;
-			default:
-				break;
-		}
-	}
+	input(EV_KEY,key,action,mods,0,0);
 }
 
 /* Executed for character input (like in text boxes) */
 void keyboardChar (GLFWwindow* window, unsigned int key)
 {
-	switch (key) {
-		case 'Q':
-		case 'q':
-			exit(0);
-			break;
-		default:
-			break;
-	}
+	input(EV_CHAR,key,0,0,0,0);
 }
-VAO *triangle[10], *rectangle[30],*circle[5],*semicircle,*brickblock[20],*bulletblocks[15];
+VAO *triangle[10], *rectangle[30],*circle[5],*semicircle,*brickblock[3],*bulletblock;
+//one line strip per path in world.aim, made the first time it is shown
+vector<VAO*> aimline;
+unsigned int aimline_version;
 
-int bullets=0;
-void createbullets (GLfloat x1,GLfloat y1,
-		GLfloat x2,GLfloat y2,
-		GLfloat x3,GLfloat y3,
-		GLfloat x4,GLfloat y4,
-		int mouseclick)
-{
-	// GL3 accepts only Triangles. Quads are not supported
-	GLfloat color_buffer_data[18]={0};
-	GLfloat vertex_buffer_data[]={
-		x1,y1,0,
-		x2,y2,0,
-		x3,y3,0,
-		x3,y3,0,
-		x4,y4,0,
-		x1,y1,0
-	};
-	for(int i=0;i<16;i+=3)
-	{
-		color_buffer_data[i]=0;
-		color_buffer_data[i+1]=0.5;
-		color_buffer_data[i+2]=1;
-	}
-	bullet[bullets%15].rad=0;
-	if(!mouseclick)
-		bullet[bullets%15].angle=0;
-	bullet[bullets%15].status=1;
-	bullet[bullets%15].trans=0;
 
-	// create3DObject creates and returns a handle to a VAO that can be used later
-	bulletblocks[bullets%15] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
-	bullets++;
-}
-
-int m_redbasket=0,m_greenbasket=0,m_canon=0,m_flag=0;
-double mouse_xpos,mouse_ypos,mouse_click_x;
 static void cursor_position(GLFWwindow* window,double xpos,double ypos)
 {
-	mouse_xpos=(10*xpos/fbwidth)-5;
-	mouse_ypos=-(10*ypos/fbheight)+5;
-	if(m_redbasket==1 && 1+mouse_xpos<5.5 && 1+mouse_xpos>-1.75)
-		rectshape[1].trans=1+mouse_xpos;
-	if(m_greenbasket && -1+mouse_xpos<3.5 && -1+mouse_xpos>-3.75)
-		rectshape[2].trans=-1+mouse_xpos;
-	if(m_canon && mouse_ypos>-3.5 && mouse_ypos<3.5)
-		rectshape[0].trans=mouse_ypos;
+	input(EV_CURSOR,0,0,0,(10*xpos/fbwidth)-5,-(10*ypos/fbheight)+5);
 }
 
 /* Executed when a mouse button is pressed/released */
 void mouseButton (GLFWwindow* window, int button, int action, int mods)
 {
-	if(action==GLFW_RELEASE){
-		if(button==GLFW_MOUSE_BUTTON_LEFT){
-			m_redbasket=0;
-			m_greenbasket=0;
-			m_canon=0;
-		}
-		if(button==GLFW_MOUSE_BUTTON_RIGHT)
-			m_flag=0;
-	}
-	else if(action==GLFW_PRESS){
-		if(button==GLFW_MOUSE_BUTTON_LEFT){
-			if(mouse_xpos>=-5.0 && mouse_xpos<=-4.65 && mouse_ypos>=rectshape[0].trans-0.1 && mouse_ypos<=rectshape[0].trans+0.1){
-				m_canon=1;
-			}
-			else if(mouse_xpos>=-1.35+rectshape[1].trans && mouse_xpos<=-0.65+rectshape[1].trans && mouse_ypos<=-3.9 && mouse_ypos>=-4.9){
-				m_redbasket=1;
-			}
-			else if(mouse_xpos>=0.65+rectshape[2].trans && mouse_xpos<=1.35+rectshape[2].trans && mouse_ypos<=-3.9 && mouse_ypos>=-4.9)
-				m_greenbasket=1;
-			else if(mouse_xpos>-4.42 && glfwGetTime()-mfire>=1){
-				float slope=(mouse_ypos-rectshape[0].trans)/(mouse_xpos+4.42);
-				float mouseangle=(atan(slope)*180.0)/M_PI;
-
-				if(mouseangle>=-60 && mouseangle<=60){
-					mfire=glfwGetTime();
-					bullet[bullets%15].angle=mouseangle;
-					rectshape[0].rotation=mouseangle;
-					thread(play_audio,"/home/sathwik/Downloads/beep5.mp3").detach();
-					createbullets(-0.09,0.03, -0.09,-0.03, 0.09,-0.03, 0.09,0.03,1);
-				}
-
-			}
-		}
-		if(button==GLFW_MOUSE_BUTTON_RIGHT){
-			if(!m_flag){
-				mouse_click_x=mouse_xpos;
-			}
-			m_flag=1;
-		}
-	}
+	input(EV_MOUSE_BUTTON,button,action,mods,0,0);
 }
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	zoom += yoffset;
-	if(zoom>=5)
-		zoom=4;
-	if(zoom<0)
-		zoom=0;
-	if(pan>zoom)
-		pan=zoom;
-	if(pan<-zoom)
-		pan=-zoom;
-	Matrices.projection = glm::ortho(-5.0f+zoom-pan, 5.0f-zoom-pan, -5.0f+zoom, 5.0f-zoom, 0.1f, 500.0f);
+	input(EV_SCROLL,0,0,0,xoffset,yoffset);
 }
 
 
@@ -596,11 +377,6 @@ void createTriangle (GLfloat x1,GLfloat y1,
 		color_buffer_data[i+1]=c2;
 		color_buffer_data[i+2]=c3;
 	}
-	trishape[j].rotation=0;
-	trishape[j].trans=0;
-	trishape[j].rot_dir=0;
-	trishape[j].trans_dir=0;
-	trishape[j].status=0;
 	triangle[j] = create3DObject(GL_TRIANGLES, 3, vertex_buffer_data, color_buffer_data, GL_LINE);
 }
 
@@ -656,11 +432,6 @@ void createRectangle (GLfloat x1,GLfloat y1,
 				color_buffer_data[i+2]=254.0/255.0;
 			}
 		}
-		rectshape[j].rotation=0;
-		rectshape[j].rot_dir=0;
-		rectshape[j].trans_dir=0;
-		rectshape[j].trans=0;
-		rectshape[j].status=1;
 	}
 	if(type)
 	{
@@ -670,39 +441,37 @@ void createRectangle (GLfloat x1,GLfloat y1,
 			color_buffer_data[i+1]=173.0/255.0;
 			color_buffer_data[i+2]=226.0/255.0;
 		}
-		if(type==1){
-			mirror[type-1].trans_x=-1.5;
-			mirror[type-1].trans_y=3.5;
-			mirror[type-1].rot=120;
-			mirror[type-1].x1=0.6*(cos(120*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y1=sin(120*M_PI/180.0f)*(0.6)+mirror[type-1].trans_y;
-			mirror[type-1].x2=-0.6*(cos(120*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y2=sin(120*M_PI/180.0f)*(-0.6)+mirror[type-1].trans_y;
-		}
-		else if(type==2){
-			mirror[type-1].trans_x=3.5;
-			mirror[type-1].trans_y=3.0;
-			mirror[type-1].rot=120;
-			mirror[type-1].x1=0.6*(cos(120*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y1=sin(120*M_PI/180.0f)*(0.6)+mirror[type-1].trans_y;
-			mirror[type-1].x2=-0.6*(cos(120*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y2=sin(120*M_PI/180.0f)*(-0.6)+mirror[type-1].trans_y;
-		}
-		else if(type==3)
-		{
-			mirror[type-1].trans_x=1;
-			mirror[type-1].trans_y=-2.5;
-			mirror[type-1].rot=25;
-			mirror[type-1].x2=0.6*(cos(25*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y2=sin(25*M_PI/180.0f)*(0.6)+mirror[type-1].trans_y;
-			mirror[type-1].x1=-0.6*(cos(25*M_PI/180.0f))+mirror[type-1].trans_x;
-			mirror[type-1].y1=sin(25*M_PI/180.0f)*(-0.6)+mirror[type-1].trans_y;
-		}
 	}
 	// create3DObject creates and returns a handle to a VAO that can be used later
 	rectangle[j] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
 }
 
+void createbullets (GLfloat x1,GLfloat y1,
+		GLfloat x2,GLfloat y2,
+		GLfloat x3,GLfloat y3,
+		GLfloat x4,GLfloat y4)
+{
+	// GL3 accepts only Triangles. Quads are not supported
+	GLfloat color_buffer_data[18]={0};
+	GLfloat vertex_buffer_data[]={
+		x1,y1,0,
+		x2,y2,0,
+		x3,y3,0,
+		x3,y3,0,
+		x4,y4,0,
+		x1,y1,0
+	};
+	for(int i=0;i<16;i+=3)
+	{
+		color_buffer_data[i]=0;
+		color_buffer_data[i+1]=0.5;
+		color_buffer_data[i+2]=1;
+	}
+
+	// create3DObject creates and returns a handle to a VAO that can be used later
+	bulletblock = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
+}
+
 void createbricks (GLfloat x1,GLfloat y1,
 		GLfloat x2,GLfloat y2,
 		GLfloat x3,GLfloat y3,
@@ -747,11 +516,20 @@ void createbricks (GLfloat x1,GLfloat y1,
 			color_buffer_data[i+2]=113.0/255.0;
 		}
 	}
-	brick_color[bricks%15]=color;
-	brick_status[bricks%15]=1;
 	// create3DObject creates and returns a handle to a VAO that can be used later
-	brickblock[bricks%15] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
-	bricks++;
+	brickblock[color] = create3DObject(GL_TRIANGLES, 6, vertex_buffer_data, color_buffer_data, GL_FILL);
+}
+VAO *createAimLine (const aimpath &p)
+{
+	GLfloat vertex_buffer_data[6*PATH_SEGS*3]={0};
+	for(int k=0;k+1<p.n;k++)
+	{
+		vertex_buffer_data[6*k]=p.x[k];
+		vertex_buffer_data[6*k+1]=p.y[k];
+		vertex_buffer_data[6*k+3]=p.x[k+1];
+		vertex_buffer_data[6*k+4]=p.y[k+1];
+	}
+	return create3DObject(GL_LINES, 2*(p.n-1), vertex_buffer_data, 1, 0.6, 0.6, GL_LINE);
 }
 void createCircle(float radius,int j)
 {
@@ -796,120 +574,75 @@ void createSemicircle(float radius)
 	}
 	semicircle = create3DObject(GL_TRIANGLES,360*3, vertex_buffer_data, color_buffer_data, GL_FILL);
 }
-void randombricks()
+float camera_rotation_angle = 90;
+
+static float lerp(float a,float b,float alpha)
 {
-	int z=rand()%8;
-	int p=rand()%3;
-	brick_x[bricks%15]=z-3;
-	float len=sqrt(0.3625);
-	float mirx1=0.6*(cos(120*M_PI/180.0f))+0.05*(sin(120*M_PI/180.0f))+mirror[0].trans_x;
-	float mirx2=-0.6*(cos(120*M_PI/180.0f))-0.05*(sin(120*M_PI/180.0f))+mirror[0].trans_x;
-	float mirx3=0.6*(cos(120*M_PI/180.0f))+0.05*(sin(120*M_PI/180.0f))+mirror[1].trans_x;
-	float mirx4=-0.6*(cos(120*M_PI/180.0f))-0.05*(sin(120*M_PI/180.0f))+mirror[1].trans_x;
-	float mirx5=0.6*(cos(25*M_PI/180.0f))-0.05*(sin(25*M_PI/180.0f))+mirror[2].trans_x;
-	float mirx6=-0.6*(cos(25*M_PI/180.0f))+0.05*(sin(25*M_PI/180.0f))+mirror[2].trans_x;
-	//restrict bricks from falling on mirrors
-	while((z-3>mirx1 && z-3<mirx2) || (z-3>mirx3 && z-3<mirx4) || (z-3>mirx6 && z-3<mirx5))
-		z=rand()%8;
-	createbricks(-0.1+z,0.2, -0.1+z,-0.2, 0.1+z,-0.2, 0.1+z,0.2, p);
+	return a+(b-a)*alpha;
 }
-//for penalty box
-int wrong=0,tricount=1;
-void checkcollision()
-{
-	for(int i=0;i<15;i++)
-	{
-		for(int j=0;j<15;j++)
-		{
-			if(brick_status[i] && bullet[j].status){
-				if(bullet[j].newx+0.09*cos(bullet[j].angle*M_PI/180.0f)>=brick_x[i]-0.1 && bullet[j].newx+0.09*cos(bullet[j].angle*M_PI/180.0f)<=brick_x[i]+0.1 && bullet[j].newy>=4.55-brick_trans[i] && bullet[j].newy<=4.95-brick_trans[i])
-				{
-					if(brick_color[i]==0)
-						score+=10;
-					else{
-						createTriangle (-0.2,0.25, -0.2,0.25, 0.1,-0.25, 250.0/255,23.0/255.0,5.0/255.0, tricount);
-						createTriangle (0.1,0.25, 0.1,0.25, -0.2,-0.25, 250.0/255,23.0/255.0,5.0/255.0, tricount+1);
-						tricount+=2;
-						wrong++;
-						score-=5;
-						if(wrong>4)
-						{
-							printf("GAME OVER!\n");
-							printf("Score: %d\n",score);
-							thread(play_audio,"/home/sathwik/Downloads/beep4.mp3").detach();
-							exit(0);
-						}
-					}
-					brick_status[i]=0;
-					bullet[j].status=0;
-					bullet[j].angle=0;
-					bullet[j].trans=0;
-					brick_trans[i]=0;
-					printf("Score: %d\n",score);
-					break;
-				}
-			}
-		}
-	}
-}
-float x_intersection,y_intersection;
-int intersection(float x0,float x1,float y0,float y1,int i)
-{
-	float x2=0.09*cos(bullet[i].angle*M_PI/180.0f)+bullet[i].newx;
-	float y2=0.09*sin(bullet[i].angle*M_PI/180.0f)+bullet[i].newy-0.01;
-	float x3=-0.09*cos(bullet[i].angle*M_PI/180.0f)+bullet[i].newx;
-	float y3=-0.09*sin(bullet[i].angle*M_PI/180.0f)+bullet[i].newy-0.01;
 
-	float s1_x, s1_y, s2_x, s2_y, q, p, r;
+/* Projection times view for this frame */
+glm::mat4 VP;
 
-	s1_x = x1 - x0;
-	s1_y = y1 - y0;
-	s2_x = x3 - x2;
-	s2_y = y3 - y2;
+/* MVP of every brick, bullet and mirror, built by frame tasks on any
+   thread and drawn by draw() on the one with the GL context */
+vector<glm::mat4> brick_mvp, bullet_mvp, mirror_mvp;
 
-	r=s1_x*s2_y - s2_x*s1_y;
-	if(r==0){
-		return 0;
-	}
+/* Set up the camera for the snapshot's zoom and pan and size the
+   transform arrays for its objects */
+void camera (const Snapshot &s)
+{
+	// Compute Camera matrix (view)
+	// Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
+	//  Don't change unless you are sure!!
+	Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(0,1,0)); // Fixed camera for 2D (ortho) in XY plane
 
-	p = (s1_x*(y0-y2) - s1_y*(x0-x2))/(r*1.0f);
-	q = (s2_x*(y0-y2) - s2_y*(x0-x2))/(r*1.0f);
+	// Compute ViewProject matrix as view/camera might not be changed for this frame (basic scenario)
+	//  Don't change unless you are sure!!
+	Matrices.projection = glm::ortho(-5.0f+s.zoom-s.pan, 5.0f-s.zoom-s.pan, -5.0f+s.zoom, 5.0f-s.zoom, 0.1f, 500.0f);
+	VP = Matrices.projection * Matrices.view;
 
-	if (p>=0 && p<=1 && q>=0 && q<=1)
-	{
-		x_intersection = x0 + (q * s1_x);
-		y_intersection = y0 + (q * s1_y);
-		return 1;
+	brick_mvp.resize(s.brick_x.size());
+	bullet_mvp.resize(s.bullet.size());
+}
+
+/* Transforms of slice k of n of the bricks */
+void brick_transforms (const Snapshot &s, int k, int n)
+{
+	long count=s.brick_x.size();
+	for(int var=count*k/n;var<count*(k+1)/n;var++)
+		brick_mvp[var] = VP * glm::translate (glm::vec3(s.brick_x[var],4.75-lerp(s.brick_prev[var],s.brick_trans[var],s.alpha),0));
+}
+
+void bullet_transforms (const Snapshot &s)
+{
+	for(size_t var=0;var<s.bullet.size();var++){
+		const bulletview &b=s.bullet[var];
+		glm::mat4 translateRectangle3 = glm::translate (glm::vec3(lerp(b.prevx,b.newx,s.alpha),lerp(b.prevy,b.newy,s.alpha)-0.01, 0));
+		// rotation about z straight from the unit direction, no trig needed
+		glm::mat4 rotateRectangle3 = glm::mat4(1.0f);
+		rotateRectangle3[0][0] = b.dirx;
+		rotateRectangle3[0][1] = b.diry;
+		rotateRectangle3[1][0] = -b.diry;
+		rotateRectangle3[1][1] = b.dirx;
+		bullet_mvp[var] = VP * (translateRectangle3 * rotateRectangle3);
 	}
-	return 0;
 }
-int reflect[20]={0};
-void checkreflection()
+
+void mirror_transforms (const Snapshot &s)
 {
-	for(int i=0;i<15;i++)
+	mirror_mvp.resize(s.mirror_xf.size());
+	for(size_t q=0;q<s.mirror_xf.size();q++)
 	{
-		//mirror1 with angle 120deg, -1.5 transx and 3.5 transy
-		for(int j=0;j<3;j++)
-		{
-			if(bullet[i].status==1){
-				if(intersection(mirror[j].x1,mirror[j].x2,mirror[j].y1,mirror[j].y2,i))
-				{
-					bullet[i].nx=x_intersection;
-					bullet[i].ny=y_intersection+0.01;
-					reflect[i]=1;
-					bullet[i].angle=2*mirror[j].rot-bullet[i].angle;
-					bullet[i].status=1;
-					bullet[i].rad=0.16;
-				}
-			}
-		}
+		glm::mat4 translateRectangle5 = glm::translate (glm::vec3(s.mirror_xf[q].x,s.mirror_xf[q].y, 0));
+		glm::mat4 rotateRectangle5 = glm::rotate((float)(s.mirror_xf[q].rot*M_PI/180.0f), glm::vec3(0,0,1));
+		mirror_mvp[q] = VP * (translateRectangle5 * rotateRectangle5);
 	}
 }
-float camera_rotation_angle = 90;
 
-/* Render the scene with openGL */
-/* Edit this function according to your assignment */
-void draw ()
+/* Render a snapshot with openGL; camera() and the transform builders
+   must have run on it */
+void draw (const Snapshot &s)
 {
 	// clear the color and depth in the frame buffer
 	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -925,15 +658,6 @@ void draw ()
 	// Up - Up vector defines tilt of camera.  Don't change unless you are sure!!
 	glm::vec3 up (0, 1, 0);
 
-	// Compute Camera matrix (view)
-	// Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
-	//  Don't change unless you are sure!!
-	Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(0,1,0)); // Fixed camera for 2D (ortho) in XY plane
-
-	// Compute ViewProject matrix as view/camera might not be changed for this frame (basic scenario)
-	//  Don't change unless you are sure!!
-	glm::mat4 VP = Matrices.projection * Matrices.view;
-
 	// Send our transformation to the currently bound shader, in the "MVP" uniform
 	// For each model you render, since the MVP will be different (at least the M part)
 	//  Don't change unless you are sure!!
@@ -943,9 +667,13 @@ void draw ()
 	Matrices.model = glm::mat4(1.0f);
 
 	/* Render your scene */
+	float canon_trans=lerp(s.player_prev[PLAYER_CANON].y,s.player[PLAYER_CANON].y,s.alpha);
+	float canon_rotation=lerp(s.player_prev[PLAYER_CANON].rot,s.player[PLAYER_CANON].rot,s.alpha);
+	float redbasket_trans=lerp(s.player_prev[PLAYER_RED].x,s.player[PLAYER_RED].x,s.alpha);
+	float greenbasket_trans=lerp(s.player_prev[PLAYER_GREEN].x,s.player[PLAYER_GREEN].x,s.alpha);
 
 	glm::mat4 translateTriangle = glm::translate (glm::vec3(0.0f, -3.6f, 0.0f)); // glTranslatef
-	glm::mat4 rotateTriangle = glm::rotate((float)(trishape[0].rotation*M_PI/180.0f), glm::vec3(0,0,1));  // rotate about vector (1,0,0)
+	glm::mat4 rotateTriangle = glm::rotate((float)(0*M_PI/180.0f), glm::vec3(0,0,1));  // rotate about vector (1,0,0)
 	glm::mat4 triangleTransform = translateTriangle * rotateTriangle;
 	Matrices.model *= triangleTransform;
 	MVP = VP * Matrices.model; // MVP = p * V * M
@@ -959,143 +687,70 @@ void draw ()
 	// Pop matrix to undo transformations till last push matrix instead of recomputing model matrix
 	// glPopMatrix ();
 	Matrices.model = glm::mat4(1.0f);
-	glm::mat4 translateRectangle = glm::translate (glm::vec3(-4.77,rectshape[0].trans, 0));
+	glm::mat4 translateRectangle = glm::translate (glm::vec3(-4.77,canon_trans, 0));
 	// glTranslatef
-	glm::mat4 rotateRectangle = glm::rotate((float)(rectshape[0].rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
+	glm::mat4 rotateRectangle = glm::rotate((float)(canon_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateRectangle * rotateRectangle);
 	MVP = VP * Matrices.model;
 	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-	draw3DObject(rectangle[0]);
+	draw3DObject(rectangle[MESH_CANON]);
 
 	//RED BASKET
 	Matrices.model = glm::mat4(1.0f);
-	glm::mat4 translateRectangle1 = glm::translate (glm::vec3(-1+rectshape[1].trans,-4.4, 2));
+	glm::mat4 translateRectangle1 = glm::translate (glm::vec3(-1+redbasket_trans,-4.4, 2));
 	// glTranslatef
 	glm::mat4 rotateRectangle1 = glm::rotate((float)(0*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateRectangle1 * rotateRectangle1);
 	MVP = VP * Matrices.model;
 	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-	draw3DObject(rectangle[1]);
+	draw3DObject(rectangle[MESH_RED_BASKET]);
 
 	//GREEN BASKET
 	Matrices.model = glm::mat4(1.0f);
-	glm::mat4 translateRectangle2 = glm::translate (glm::vec3(1+rectshape[2].trans,-4.4, 2));
+	glm::mat4 translateRectangle2 = glm::translate (glm::vec3(1+greenbasket_trans,-4.4, 2));
 	// glTranslatef
 	glm::mat4 rotateRectangle2 = glm::rotate((float)(0*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateRectangle2 * rotateRectangle2);
 	MVP = VP * Matrices.model;
 	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-	draw3DObject(rectangle[2]);
+	draw3DObject(rectangle[MESH_GREEN_BASKET]);
 
 
 	//***BRICKS***
-	current_time1 = glfwGetTime();
-	if ((current_time1 - last_update_time1) >= 2.0) {
-		last_update_time1 = current_time1;
-		randombricks();
-	}
-	for(int var=0;var<15;var++)
+	for(size_t var=0;var<brick_mvp.size();var++)
 	{
-		if(brick_status[var]==1)
-		{
-			Matrices.model = glm::mat4(1.0f);
-			glm::mat4 translateRectangle4 = glm::translate (glm::vec3(-3,4.75-brick_trans[var],0));
-			// glTranslatef
-			glm::mat4 rotateRectangle4 = glm::rotate((float)(0*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-			Matrices.model *= (translateRectangle4 * rotateRectangle4);
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-			draw3DObject(brickblock[var]);
-
-			brick_trans[var]+=brick_increment;
-
-			if(4.75-brick_trans[var]<-3.9)
-			{
-				if(brick_color[var]==1){
-					if(abs(-1+rectshape[1].trans-(1+rectshape[2].trans))<=0.35)
-						score--;
-					else if(-1+rectshape[1].trans<=brick_x[var]+0.25 && -1+rectshape[1].trans>=brick_x[var]-0.25)
-						score++;
-					else
-						score--;
-				}
-
-				if(brick_color[var]==2){
-					if(abs(-1+rectshape[1].trans-(1+rectshape[2].trans))<=0.35)
-						score--;
-					else if(1+rectshape[2].trans<=brick_x[var]+0.25 && 1+rectshape[2].trans>=brick_x[var]-0.25)
-					{
-						score+=1;
-					}
-					else
-						score-=1;
-				}
-				brick_status[var]=0;
-				brick_trans[var]=0;
-				printf("Score: %d\n",score);
-				if(brick_color[var]==0)
-				{
-					//system("canberra-gtk-play -f /home/sathwik/Downloads/smb_gameover.wav");
-					//thread(play_audio,"/home/sathwik/Downloads/beep4.mp3").detach();
-					printf("\n GAMEOVER \n");
-					printf("Score: %d \n",score);
-					exit(0);
-				}
-			}
-		}
+		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &brick_mvp[var][0][0]);
+		draw3DObject(brickblock[s.brick_color[var]]);
 	}
-	for(int q=0;q<3;q++)
+	for(size_t q=0;q<mirror_mvp.size();q++)
 	{
+		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &mirror_mvp[q][0][0]);
+		draw3DObject(rectangle[s.mirror_mesh[q]]);
+	}
+	//AIM PREVIEW
+	if(s.aim>=0){
+		if(aimline_version!=s.aim_version){
+			for(size_t k=0;k<aimline.size();k++)
+				if(aimline[k])
+					delete3DObject(aimline[k]);
+			aimline.clear();
+			aimline_version=s.aim_version;
+		}
+		int p=s.aim;
+		if(p>=(int)aimline.size())
+			aimline.resize(p+1,(VAO*)NULL);
+		if(!aimline[p])
+			aimline[p]=createAimLine(s.aim_path);
 		Matrices.model = glm::mat4(1.0f);
-		glm::mat4 translateRectangle5 = glm::translate (glm::vec3(mirror[q].trans_x,mirror[q].trans_y, 0));
-		// glTranslatef
-		glm::mat4 rotateRectangle5 = glm::rotate((float)(mirror[q].rot*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-		Matrices.model *= (translateRectangle5 * rotateRectangle5);
 		MVP = VP * Matrices.model;
 		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-		draw3DObject(rectangle[3+q]);
+		draw3DObject(aimline[p]);
 	}
 	//BULLETS
-	current_time2 = glfwGetTime();
-	if ((current_time2 - last_update_time2) >= 1.0 && spaceflag==1) {
-		last_update_time2 = current_time2;
-		createbullets(-0.09,0.03, -0.09,-0.03, 0.09,-0.03, 0.09,0.03,0);
-			thread(play_audio,"/home/sathwik/Downloads/beep5.mp3").detach();
-	}
-	for(int var=0;var<15;var++){
-		if(bullet[var].status==1)
-		{
-			Matrices.model = glm::mat4(1.0f);
-			if(bullet[var].angle==0 && reflect[var]==0)
-				bullet[var].angle=rectshape[0].rotation;
-			if(bullet[var].trans==0)
-				bullet[var].trans=rectshape[0].trans;
-			if(!reflect[var]){
-				bullet[var].newx=-4.68+bullet[var].rad*cos(bullet[var].angle*M_PI/180.0f);
-				bullet[var].newy=bullet[var].trans+bullet[var].rad*sin(bullet[var].angle*M_PI/180.0f);
-			}
-			if(reflect[var])
-			{
-				bullet[var].newx=bullet[var].nx+bullet[var].rad*(cos(bullet[var].angle*M_PI/180.0f));
-				bullet[var].newy=bullet[var].ny+bullet[var].rad*sin(bullet[var].angle*M_PI/180.0f);
-			}
-			glm::mat4 translateRectangle3 = glm::translate (glm::vec3(bullet[var].newx,bullet[var].newy-0.01, 0));
-			// glTranslatef
-			glm::mat4 rotateRectangle3 = glm::rotate((float)(bullet[var].angle*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-			Matrices.model *= (translateRectangle3 * rotateRectangle3);
-			MVP = VP * Matrices.model;
-			glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-			draw3DObject(bulletblocks[var]);
-			bullet[var].rad+=0.16;
-			if(bullet[var].newx>4.8 || bullet[var].newx<-4.8 || bullet[var].newy>4.8 || bullet[var].newy<-4.8){
-				bullet[var].status=0;
-				bullet[var].rad=0;
-				reflect[var]=0;
-			}
-		}
+	for(size_t var=0;var<bullet_mvp.size();var++){
+		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &bullet_mvp[var][0][0]);
+		draw3DObject(bulletblock);
 	}
-	checkcollision();
-	checkreflection();
 
 	//penaltybox
 	for(int i=0;i<4;i++){
@@ -1108,7 +763,7 @@ void draw ()
 		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
 		draw3DObject(rectangle[6+i]);
 	}
-	for(int j=0;j<wrong;j++){
+	for(int j=0;j<s.wrong && j<4;j++){
 		for(int i=0;i<2;i++){
 			Matrices.model = glm::mat4(1.0f);
 			glm::mat4 translateTriangle1 = glm::translate (glm::vec3(-4.7+0.33*j,4.5,0));
@@ -1120,21 +775,9 @@ void draw ()
 			draw3DObject(triangle[1+i+2*j]);
 		}
 	}
-	float laser_incr=0.1;
-	float laser_trans_check=rectshape[3].trans+laser_incr*rectshape[3].trans_dir;
-	if(laser_trans_check<9.0)
-	{
-		rectshape[3].trans=laser_trans_check;
-	}
-	else
-	{
-		rectshape[3].trans=0;
-		rectshape[3].trans_dir=0;
-	}
-
 	Matrices.model = glm::mat4(1.0f);
 
-	glm::mat4 translateCircle = glm::translate (glm::vec3(-1+rectshape[1].trans, -3.9, 0));        // glTranslatef
+	glm::mat4 translateCircle = glm::translate (glm::vec3(-1+redbasket_trans, -3.9, 0));        // glTranslatef
 	glm::mat4 rotateCircle = glm::rotate((float)(65*M_PI/180.0f), glm::vec3(1,0,0)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateCircle * rotateCircle);
 	MVP = VP * Matrices.model;
@@ -1143,7 +786,7 @@ void draw ()
 
 	Matrices.model = glm::mat4(1.0f);
 
-	glm::mat4 translateCircle1 = glm::translate (glm::vec3(1+rectshape[2].trans,-3.9, 0));        // glTranslatef
+	glm::mat4 translateCircle1 = glm::translate (glm::vec3(1+greenbasket_trans,-3.9, 0));        // glTranslatef
 	glm::mat4 rotateCircle1 = glm::rotate((float)(65*M_PI/180.0f), glm::vec3(1,0,0)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateCircle1 * rotateCircle1);
 	MVP = VP * Matrices.model;
@@ -1152,47 +795,12 @@ void draw ()
 
 	Matrices.model = glm::mat4(1.0f);
 
-	glm::mat4 translateSemicircle = glm::translate (glm::vec3(-5,rectshape[0].trans, 0));        // glTranslatef
+	glm::mat4 translateSemicircle = glm::translate (glm::vec3(-5,canon_trans, 0));        // glTranslatef
 	glm::mat4 rotateSemicircle = glm::rotate((float)(semicircle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
 	Matrices.model *= (translateSemicircle * rotateSemicircle);
 	MVP = VP * Matrices.model;
 	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
 	draw3DObject(semicircle);
-	// Increment angles
-	float increments = 1,trans_increment=0.03;
-	float redbasket_trans_check=rectshape[1].trans+trans_increment*rectshape[1].trans_dir;
-	if(redbasket_trans_check<5.5 && redbasket_trans_check>-1.75)
-	{
-		rectshape[1].trans=redbasket_trans_check;
-	}
-	float greenbasket_trans_check=rectshape[2].trans+trans_increment*rectshape[2].trans_dir;
-	if(greenbasket_trans_check<3.5 && greenbasket_trans_check>-3.75)
-	{
-		rectshape[2].trans=greenbasket_trans_check;
-	}
-	//camera_rotation_angle++; // Simulating camera rotation
-	float rectangle_rot_check=rectshape[0].rotation + increments*(rectshape[0].rot_dir);
-	if(rectangle_rot_check<60 && rectangle_rot_check>-60)
-	{
-		rectshape[0].rotation=rectangle_rot_check;
-	}
-	float canon_trans_check=rectshape[0].trans+trans_increment*rectshape[0].trans_dir;
-	if(canon_trans_check<3.5 && canon_trans_check>-3.5)
-	{
-		rectshape[0].trans=canon_trans_check;
-	}
-	//mousepan
-	if(m_flag && zoom>0){
-		pan-=(mouse_click_x - mouse_xpos);
-		mouse_click_x=mouse_xpos;
-		if(pan>zoom)
-			pan=zoom;
-		if(pan<-zoom)
-			pan=-zoom;
-		Matrices.projection = glm::ortho(-5.0f+zoom-pan, 5.0f-zoom-pan, -5.0f+zoom, 5.0f-zoom, 0.1f, 500.0f);
-	}
-
-
 }
 
 /* Initialise glfw window, I/O callbacks and the renderer to use */
@@ -1267,6 +875,15 @@ void initGL (GLFWwindow* window, int width, int height)
 	createRectangle(-0.2,0.25, -0.2,-0.25, 0.1,-0.25, 0.1,0.25, 7, 4, 0);
 	createRectangle(-0.2,0.25, -0.2,-0.25, 0.1,-0.25, 0.1,0.25, 8, 4, 0);
 	createRectangle(-0.2,0.25, -0.2,-0.25, 0.1,-0.25, 0.1,0.25, 9, 4, 0);
+	//crosses drawn over the penalty boxes
+	for(int i=1;i<9;i+=2){
+		createTriangle (-0.2,0.25, -0.2,0.25, 0.1,-0.25, 250.0/255,23.0/255.0,5.0/255.0, i);
+		createTriangle (0.1,0.25, 0.1,0.25, -0.2,-0.25, 250.0/255,23.0/255.0,5.0/255.0, i+1);
+	}
+	createbricks(-0.1,0.2, -0.1,-0.2, 0.1,-0.2, 0.1,0.2, 0);
+	createbricks(-0.1,0.2, -0.1,-0.2, 0.1,-0.2, 0.1,0.2, 1);
+	createbricks(-0.1,0.2, -0.1,-0.2, 0.1,-0.2, 0.1,0.2, 2);
+	createbullets(-0.09,0.03, -0.09,-0.03, 0.09,-0.03, 0.09,0.03);
 
 	// Create and compile our GLSL program from the shaders
 	programID = LoadShaders( "Sample_GL.vert", "Sample_GL.frag" );
@@ -1295,33 +912,166 @@ int main (int argc, char** argv)
 {
 	int width = 1400;//1400
 	int height = 800;//800
+	int tick_rate = TICK_RATE;
+	const char *record_path = NULL, *trace_path = NULL, *mirror_path = NULL, *level_path = NULL;
+	uint64_t seed = 1;
+	int event_driven = 0;
+	int threads = thread::hardware_concurrency();
+	int profile = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--rate") && i+1 < argc)
+			tick_rate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i+1 < argc)
+			seed = strtoull(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--record") && i+1 < argc)
+			record_path = argv[++i];
+		else if (!strcmp(argv[i], "--trace-out") && i+1 < argc)
+			trace_path = argv[++i];
+		else if (!strcmp(argv[i], "--events"))
+			event_driven = 1;
+		else if (!strcmp(argv[i], "--mirrors") && i+1 < argc)
+			mirror_path = argv[++i];
+		else if (!strcmp(argv[i], "--level") && i+1 < argc)
+			level_path = argv[++i];
+		else if (!strcmp(argv[i], "--threads") && i+1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--profile"))
+			profile = 1;
+	}
+	if (tick_rate <= 0)
+		tick_rate = TICK_RATE;
+	if (trace_path && !trace.open_out(trace_path))
+		return 1;
+
+	world.init(seed);
+	if (mirror_path && !world.load_mirrors(mirror_path))
+		return 1;
+	world.event_driven = event_driven;
+	// scores are printed by the frame's log task
+	world.quiet = 1;
+	pool.start(threads);
+	jobs.start(threads);
+	// one beep can wait while another plays; more are dropped
+	sounds.start(1);
+	world.pool = &pool;
+	if (level_path && (!level.open(level_path) || !level.start(world)))
+		return 1;
+	if (record_path) {
+		RecordSetup rs;
+		if (!record_setup(world, mirror_path, level_path, rs) || !recorder.open(record_path, tick_rate, seed, rs))
+			return 1;
+	}
+	select_touch8(ISA_AUTO);
 
 	GLFWwindow* window = initGLFW(width, height);
 
 	initGL (window, width, height);
 
-	double last_update_time = glfwGetTime(), current_time;
+	double current_time;
+	double last_frame_time = glfwGetTime(), accumulator = 0;
+	double tick = 1.0/tick_rate;
+	int shots = 0, score = 0;
+	int slices = jobs.threads();
+	FrameProfile prof;
+	// the frame draws snaps[shown] while the simulation fills the other
+	Snapshot snaps[2];
+	int shown = 0;
+	take_snapshot(world, 0, snaps[shown]);
 
 	/* Draw in loop */
-	while (!glfwWindowShouldClose(window)) {
-
-		// OpenGL Draw commands
-		draw();
+	while (!glfwWindowShouldClose(window) && !world.gameover) {
+
+		// Each frame is a task graph run as two chains side by side: the
+		// simulation ticks, sound and log on a worker, and the camera,
+		// transforms and GL calls for the previous frame's snapshot
+		jobs.clear();
+		const Snapshot &s = snaps[shown];
+		Snapshot &next = snaps[!shown];
+		// added first so this thread starts on the render chain and a
+		// worker on the simulation
+		int cam = jobs.add("camera", [&] {
+			camera(s);
+		});
+		int sim = jobs.add("simulate", [&] {
+			// Run as many fixed simulation ticks as the elapsed time covers
+			current_time = glfwGetTime();
+			accumulator += current_time - last_frame_time;
+			last_frame_time = current_time;
+			// After a long stall drop the backlog instead of trying to catch up
+			if (accumulator > 0.25)
+				accumulator = 0.25;
+			while (accumulator >= tick && !world.gameover) {
+				world.step(tick);
+				if (trace.out) {
+					world.sync();
+					trace.tick(world.tick, world_checksum(world));
+				}
+				accumulator -= tick;
+			}
+			// event-driven worlds fill in positions first
+			world.sync();
+			take_snapshot(world, accumulator/tick, next);
+		});
+		vector<int> drawn;
+		for (int k = 0; k < slices; k++)
+			drawn.push_back(jobs.add("bricks", [&, k] {
+				brick_transforms(s, k, slices);
+			}));
+		drawn.push_back(jobs.add("bullets", [&] {
+			bullet_transforms(s);
+		}));
+		drawn.push_back(jobs.add("mirrors", [&] {
+			mirror_transforms(s);
+		}));
+		int render = jobs.add_main("draw", [&] {
+			draw(s);
+		});
+		for (size_t k = 0; k < drawn.size(); k++) {
+			jobs.after(cam, drawn[k]);
+			jobs.after(drawn[k], render);
+		}
+		int t = jobs.add("audio", [&] {
+			if (world.shots != shots) {
+				shots = world.shots;
+				sounds.post([] { play_audio("/home/sathwik/Downloads/beep5.mp3"); });
+			}
+			if (world.gameover == 2)
+				sounds.post([] { play_audio("/home/sathwik/Downloads/beep4.mp3"); });
+		});
+		jobs.after(sim, t);
+		t = jobs.add("log", [&] {
+			if (world.score != score) {
+				score = world.score;
+				printf("Score: %d\n", score);
+			}
+			if (world.gameover == 1)
+				printf("\n GAMEOVER \nScore: %d \n", world.score);
+			if (world.gameover == 2)
+				printf("GAME OVER!\nScore: %d\n", world.score);
+		});
+		jobs.after(sim, t);
+		jobs.run();
+		// the snapshot just filled is drawn next frame
+		shown = !shown;
+		// about once a second at 60 frames per second
+		if (profile) {
+			prof.add(jobs);
+			if (prof.frames == 60) {
+				prof.print();
+				prof.reset();
+			}
+		}
 
 		// Swap Frame Buffer in double buffering
 		glfwSwapBuffers(window);
 
 		// Poll for Keyboard and mouse events
 		glfwPollEvents();
-
-		// Control based on time (Time based transformation like 5 degrees rotation every 0.5s)
-		current_time = glfwGetTime(); // Time in seconds
-		if ((current_time - last_update_time) >= 0.5) { // atleast 0.5s elapsed since last frame
-			// do something every 0.5 seconds ..
-			last_update_time = current_time;
-		}
 	}
 
+	recorder.close(world.tick);
+	trace.close();
 	glfwTerminate();
 	//    exit(EXIT_SUCCESS);
 }
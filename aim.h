@@ -0,0 +1,92 @@
+#ifndef AIM_H
+#define AIM_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bullets.h"
+
+/* Aim preview paths cached by canon angle and height.
+
+   The canon turns between -60 and 60 degrees and slides between -3.5 and
+   3.5, so rounding the angle to whole degrees and the height to
+   AIM_HEIGHT_STEP gives a small fixed table. Each entry is traced the
+   first time it is asked for and kept until a mirror moves across its
+   path, so aiming costs a lookup per frame instead of a bounce-by-bounce
+   trace. A dropped entry is traced again into a new place in paths, so
+   a path's index keeps meaning the same path until clear(). */
+
+#define AIM_MAX_ANGLE 60
+#define AIM_MAX_HEIGHT 3.5f
+#define AIM_HEIGHT_STEP 0.05f
+
+/* Corners of a preview path, from the muzzle to where it leaves the field */
+typedef struct aimpath{
+	int n;
+	float x[PATH_SEGS+1];
+	float y[PATH_SEGS+1];
+}aimpath;
+
+struct AimCache {
+	//table cell -> index in paths, -1 until traced
+	std::vector<int> slot;
+	std::vector<aimpath> paths;
+	//index in paths -> table cell, -1 once dropped
+	std::vector<int> cell_of;
+	//changed by clear(), never to a value used before, so callers can
+	//drop anything built from old paths
+	unsigned int version;
+
+	AimCache() : version(0) {}
+
+	static int angles()
+	{
+		return 2*AIM_MAX_ANGLE+1;
+	}
+
+	static int heights()
+	{
+		return (int)lroundf(2*AIM_MAX_HEIGHT/AIM_HEIGHT_STEP)+1;
+	}
+
+	/* Table cell for an angle and height, clamped to the canon's range */
+	static int cell(float angle,float height)
+	{
+		int a=lroundf(angle)+AIM_MAX_ANGLE;
+		int h=lroundf((height+AIM_MAX_HEIGHT)/AIM_HEIGHT_STEP);
+		a=a<0 ? 0 : a>=angles() ? angles()-1 : a;
+		h=h<0 ? 0 : h>=heights() ? heights()-1 : h;
+		return a*heights()+h;
+	}
+
+	/* Angle and height a cell stands for */
+	static float cell_angle(int c)
+	{
+		return c/heights()-AIM_MAX_ANGLE;
+	}
+
+	static float cell_height(int c)
+	{
+		return (c%heights())*AIM_HEIGHT_STEP-AIM_MAX_HEIGHT;
+	}
+
+	/* Forget path p; its cell is traced again when next asked for */
+	void drop(int p)
+	{
+		slot[cell_of[p]]=-1;
+		cell_of[p]=-1;
+	}
+
+	/* Forget every path. The table keeps its allocation. */
+	void clear()
+	{
+		std::fill(slot.begin(),slot.end(),-1);
+		paths.clear();
+		cell_of.clear();
+		static unsigned int versions=0;
+		version=++versions;
+	}
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef BRICKS_H
+#define BRICKS_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Falling bricks stored as a structure of arrays. Live bricks always fill
+   the dense range [0,count) so update loops touch only live bricks in
+   contiguous memory; removing a brick moves the last one into its place.
+   Every brick also gets an id that stays valid while it lives. Ids of
+   removed bricks go on a free list and are handed out again. */
+struct BrickPool {
+	//dense arrays, indexed 0..count-1
+	std::vector<float> x,trans,prev;
+	std::vector<int> color;
+	std::vector<int> id;
+	int count;
+
+	//id -> dense index, -1 for ids on the free list
+	std::vector<int> index;
+	//id -> number of times the id has been freed
+	std::vector<uint32_t> gen;
+	std::vector<int> free_ids;
+
+	BrickPool() : count(0) {}
+
+	int add(float bx,int bcolor)
+	{
+		if(count==(int)x.size()){
+			int size=count ? 2*count : 16;
+			x.resize(size);
+			trans.resize(size);
+			prev.resize(size);
+			color.resize(size);
+			id.resize(size);
+		}
+		int bid;
+		if(free_ids.empty()){
+			bid=index.size();
+			index.push_back(count);
+			gen.push_back(0);
+		}
+		else{
+			bid=free_ids.back();
+			free_ids.pop_back();
+			index[bid]=count;
+		}
+		x[count]=bx;
+		trans[count]=0;
+		prev[count]=0;
+		color[count]=bcolor;
+		id[count]=bid;
+		count++;
+		return bid;
+	}
+
+	/* Remove the brick at dense index i; the last brick takes its place */
+	void remove(int i)
+	{
+		int last=count-1;
+		index[id[i]]=-1;
+		gen[id[i]]++;
+		free_ids.push_back(id[i]);
+		if(i!=last){
+			x[i]=x[last];
+			trans[i]=trans[last];
+			prev[i]=prev[last];
+			color[i]=color[last];
+			id[i]=id[last];
+			index[id[i]]=i;
+		}
+		count--;
+	}
+
+	void clear()
+	{
+		count=0;
+		index.clear();
+		gen.clear();
+		free_ids.clear();
+	}
+};
+
+#endif
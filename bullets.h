@@ -0,0 +1,154 @@
+#ifndef BULLETS_H
+#define BULLETS_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Segments a bullet's reflected path is traced in at a time */
+#define PATH_SEGS 8
+
+/* One straight stretch of a bullet's path */
+typedef struct pathseg{
+	float x;
+	float y;
+	float dirx;
+	float diry;
+	//distance along the whole path where the stretch starts
+	float s;
+	//mirror it bounced off to start the stretch, -1 at the muzzle
+	int mirror;
+}pathseg;
+
+typedef struct bulletshape{
+	//distance from nx,ny along dirx,diry
+	float rad;
+	//unit direction of travel; only changes when fired or reflected
+	float dirx;
+	float diry;
+	float trans;
+	float newx;
+	float newy;
+	float nx;
+	float ny;
+	float prevx;
+	float prevy;
+	//set once the bullet has bounced off a mirror
+	int reflect;
+	//mirror it last bounced off, -1 for none
+	int last_mirror;
+	//event-driven mode: time it left nx,ny, time and version of its next
+	//predicted event and the brick id that event hits (-1 for none)
+	double t0;
+	double next;
+	uint32_t version;
+	int target;
+	//plan_bullet() calls so far; lane entries from older plans are stale
+	uint32_t plan;
+	//path traced by World::tracepath() when fired and whenever a mirror
+	//changes: path[seg] is the stretch it is on and nx,ny,dirx,diry,
+	//last_mirror are copied from it. The last stretch runs to path_end,
+	//where it leaves the field (end_mirror -1) or meets end_mirror and the
+	//path is traced further.
+	pathseg path[PATH_SEGS];
+	int segs;
+	int seg;
+	float path_end;
+	int end_mirror;
+	//distance travelled along the path
+	float dist;
+}bulletshape;
+
+/* A bullet handle packs a slot number with the generation of that slot.
+   Removing a bullet bumps the generation, so old handles stop resolving
+   instead of pointing at whatever bullet reuses the slot. */
+#define BULLET_SLOT_BITS 20
+#define BULLET_SLOT_MASK ((1u<<BULLET_SLOT_BITS)-1)
+//what add() returns when every slot is taken. Slots stop short of
+//BULLET_SLOT_MASK, so it never resolves to a bullet.
+#define BULLET_NONE 0xffffffffu
+
+/* Live bullets are kept packed in b[0,count); removing one moves the last
+   bullet into its place so per-tick loops only see live bullets. */
+struct BulletPool {
+	std::vector<bulletshape> b;
+	int count;
+
+	//dense index -> slot, slot -> dense index (-1 when free)
+	std::vector<int> slot;
+	std::vector<int> index;
+	std::vector<uint32_t> gen;
+	std::vector<int> free_slots;
+
+	BulletPool() : count(0) {}
+
+	/* Add a bullet and return its handle, or BULLET_NONE if the pool
+	   already holds as many bullets as handles can address */
+	uint32_t add(const bulletshape &nb)
+	{
+		int s;
+		if(free_slots.empty()){
+			if(index.size()>=BULLET_SLOT_MASK)
+				return BULLET_NONE;
+			s=index.size();
+			index.push_back(0);
+			gen.push_back(0);
+		}
+		else{
+			s=free_slots.back();
+			free_slots.pop_back();
+		}
+		if(count==(int)b.size()){
+			b.push_back(nb);
+			slot.push_back(s);
+		}
+		else{
+			b[count]=nb;
+			slot[count]=s;
+		}
+		index[s]=count;
+		count++;
+		return (gen[s]<<BULLET_SLOT_BITS)|s;
+	}
+
+	/* Remove the bullet at dense index i; the last bullet takes its place */
+	void remove(int i)
+	{
+		int last=count-1;
+		int s=slot[i];
+		index[s]=-1;
+		gen[s]=(gen[s]+1)&(0xffffffffu>>BULLET_SLOT_BITS);
+		free_slots.push_back(s);
+		if(i!=last){
+			b[i]=b[last];
+			slot[i]=slot[last];
+			index[slot[i]]=i;
+		}
+		count--;
+	}
+
+	/* Handle of the bullet at dense index i */
+	uint32_t handle(int i) const
+	{
+		int s=slot[i];
+		return (gen[s]<<BULLET_SLOT_BITS)|s;
+	}
+
+	/* Dense index of a live bullet, or -1 if the handle is stale */
+	int find(uint32_t handle) const
+	{
+		uint32_t s=handle&BULLET_SLOT_MASK;
+		if(s>=index.size() || gen[s]!=handle>>BULLET_SLOT_BITS)
+			return -1;
+		return index[s];
+	}
+
+	void clear()
+	{
+		count=0;
+		index.clear();
+		gen.clear();
+		free_slots.clear();
+	}
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <vector>
+
+/* Bounding volume hierarchy over a set of boxes, for segment queries.
+   Items are the caller's indices 0..n-1; build() again when items come or
+   go, update() when one moves. Nodes are stored flat: an inner node's
+   children sit at child and child+1, a leaf lists items[child..child+count). */
+
+#define BVH_LEAF 4
+
+typedef struct bvhbox{
+	float x0,y0,x1,y1;
+}bvhbox;
+
+typedef struct bvhnode{
+	bvhbox box;
+	int child;
+	//number of items in a leaf, 0 for an inner node
+	int count;
+}bvhnode;
+
+struct SegmentBVH {
+	std::vector<bvhnode> node;
+	std::vector<int> items;
+	std::vector<bvhbox> boxes;
+	//parent of each node (-1 at the root) and leaf holding each item
+	std::vector<int> parent;
+	std::vector<int> leaf;
+
+	void build(const std::vector<bvhbox> &b)
+	{
+		boxes=b;
+		node.clear();
+		parent.clear();
+		items.resize(b.size());
+		leaf.resize(b.size());
+		for(size_t i=0;i<b.size();i++)
+			items[i]=i;
+		if(b.empty())
+			return;
+		node.push_back(bvhnode());
+		parent.push_back(-1);
+		split(0,0,b.size());
+	}
+
+	/* Give item i a new box and refit the nodes above it. The tree keeps
+	   its shape, so queries stay exact but slow down if items wander far
+	   from where they were built. */
+	void update(int i,const bvhbox &b)
+	{
+		boxes[i]=b;
+		for(int n=leaf[i];n>=0;n=parent[n]){
+			bvhnode &p=node[n];
+			if(p.count){
+				p.box=boxes[items[p.child]];
+				for(int k=p.child+1;k<p.child+p.count;k++)
+					grow(p.box,boxes[items[k]]);
+			}
+			else{
+				p.box=node[p.child].box;
+				grow(p.box,node[p.child+1].box);
+			}
+		}
+	}
+
+	/* Fraction along a->b where the segment enters box c, or -1 if it
+	   misses it */
+	static float enter(const bvhbox &c,float ax,float ay,float dx,float dy)
+	{
+		float t0=0,t1=1;
+		if(!slab(ax,dx,c.x0,c.x1,t0,t1) || !slab(ay,dy,c.y0,c.y1,t0,t1))
+			return -1;
+		return t0;
+	}
+
+	/* Items whose boxes the segment a->b passes through, nearest boxes
+	   first. hit(item) does the exact test and returns the fraction along
+	   the segment of its hit or -1. Boxes entered after the best hit so
+	   far are skipped. Returns the item with the smallest fraction, the
+	   lowest item on a tie, or -1; best holds its fraction. */
+	template<class F> int raycast(float ax,float ay,float bx,float by,F hit,float &best) const
+	{
+		int found=-1;
+		best=2;
+		if(node.empty())
+			return -1;
+		float dx=bx-ax,dy=by-ay;
+		int stack[64],top=0;
+		if(enter(node[0].box,ax,ay,dx,dy)>=0)
+			stack[top++]=0;
+		while(top){
+			const bvhnode &n=node[stack[--top]];
+			if(n.count){
+				for(int k=n.child;k<n.child+n.count;k++){
+					int it=items[k];
+					if(enter(boxes[it],ax,ay,dx,dy)<0)
+						continue;
+					float t=hit(it);
+					if(t>=0 && (t<best || (t==best && it<found))){
+						best=t;
+						found=it;
+					}
+				}
+				continue;
+			}
+			float t0=enter(node[n.child].box,ax,ay,dx,dy);
+			float t1=enter(node[n.child+1].box,ax,ay,dx,dy);
+			//push the farther child first so the nearer one is searched first
+			int near=n.child,far=n.child+1;
+			if(t1>=0 && (t0<0 || t1<t0)){
+				std::swap(near,far);
+				std::swap(t0,t1);
+			}
+			if(t1>=0 && t1<=best)
+				stack[top++]=far;
+			if(t0>=0 && t0<=best)
+				stack[top++]=near;
+		}
+		return found;
+	}
+
+private:
+	static void grow(bvhbox &c,const bvhbox &b)
+	{
+		c.x0=std::min(c.x0,b.x0);
+		c.y0=std::min(c.y0,b.y0);
+		c.x1=std::max(c.x1,b.x1);
+		c.y1=std::max(c.y1,b.y1);
+	}
+
+	static bool slab(float a,float d,float lo,float hi,float &t0,float &t1)
+	{
+		if(d==0)
+			return a>=lo && a<=hi;
+		float u=(lo-a)/d,v=(hi-a)/d;
+		if(u>v)
+			std::swap(u,v);
+		t0=std::max(t0,u);
+		t1=std::min(t1,v);
+		return t0<=t1;
+	}
+
+	/* Fill node n with items[lo,hi), splitting at the median centre along
+	   the longer side of its box */
+	void split(int n,int lo,int hi)
+	{
+		bvhbox c=boxes[items[lo]];
+		for(int k=lo+1;k<hi;k++)
+			grow(c,boxes[items[k]]);
+		node[n].box=c;
+		if(hi-lo<=BVH_LEAF){
+			node[n].child=lo;
+			node[n].count=hi-lo;
+			for(int k=lo;k<hi;k++)
+				leaf[items[k]]=n;
+			return;
+		}
+		bool xaxis=c.x1-c.x0>=c.y1-c.y0;
+		int mid=(lo+hi)/2;
+		const std::vector<bvhbox> &bx=boxes;
+		std::nth_element(items.begin()+lo,items.begin()+mid,items.begin()+hi,[&](int a,int b){
+			float ca=xaxis ? bx[a].x0+bx[a].x1 : bx[a].y0+bx[a].y1;
+			float cb=xaxis ? bx[b].x0+bx[b].x1 : bx[b].y0+bx[b].y1;
+			return ca<cb || (ca==cb && a<b);
+		});
+		int child=node.size();
+		node[n].child=child;
+		node[n].count=0;
+		node.push_back(bvhnode());
+		node.push_back(bvhnode());
+		parent.push_back(n);
+		parent.push_back(n);
+		split(child,lo,mid);
+		split(child+1,mid,hi);
+	}
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <cstring>
+
+#include "checksum.h"
+#include "world.h"
+
+using namespace std;
+
+/* murmur3 32 bit finaliser */
+static inline uint32_t fmix32(uint32_t h)
+{
+	h^=h>>16;
+	h*=0x85ebca6b;
+	h^=h>>13;
+	h*=0xc2b2ae35;
+	h^=h>>16;
+	return h;
+}
+
+static inline uint32_t bits(float f)
+{
+	uint32_t u;
+	memcpy(&u,&f,4);
+	return u;
+}
+
+/* Hash up to four words with the given lane seed */
+static inline uint32_t hash4(uint32_t seed,uint32_t a,uint32_t b,uint32_t c,uint32_t d)
+{
+	uint32_t h=fmix32(seed^a);
+	h=fmix32(h^b);
+	h=fmix32(h^c);
+	return fmix32(h^d);
+}
+
+/* Two independent 32 bit lanes make up the 64 bit result */
+#define LANE0 0x9e3779b9u
+#define LANE1 0x7f4a7c15u
+
+uint64_t world_checksum(const World &world)
+{
+	uint32_t h0=0,h1=0;
+
+	const BrickPool &brick=world.brick;
+	for(int i=0;i<brick.count;i++){
+		uint32_t x=bits(brick.x[i]),y=bits(brick.trans[i]),c=bits(brick.color[i]);
+		h0+=hash4(LANE0,x,y,c,1);
+		h1+=hash4(LANE1,x,y,c,1);
+	}
+	for(int i=0;i<world.bullet.count;i++){
+		const bulletshape &b=world.bullet.b[i];
+		uint32_t x=bits(b.newx),y=bits(b.newy),dx=bits(b.dirx),dy=bits(b.diry),r=b.reflect;
+		h0+=fmix32(hash4(LANE0,x,y,dx,dy)^(2+r));
+		h1+=fmix32(hash4(LANE1,x,y,dx,dy)^(2+r));
+	}
+
+	//everything else is hashed in a fixed order
+	for(int i=0;i<world.mirrors.size();i++){
+		const xform &m=world.mirrors.xf(i);
+		h0=hash4(h0,bits(m.x),bits(m.y),bits(m.rot),i);
+		h1=hash4(h1^LANE1,bits(m.x),bits(m.y),bits(m.rot),i);
+	}
+	for(int i=0;i<world.players.size();i++){
+		const xform &x=world.players.xf(i);
+		const velocity &v=world.players.vel(i);
+		h0=hash4(h0,bits(x.x),bits(x.y),bits(x.rot),i);
+		h0=hash4(h0,bits(v.vx),bits(v.vy),bits(v.spin),i);
+		h1=hash4(h1^LANE1,bits(x.x),bits(x.y),bits(x.rot),i);
+		h1=hash4(h1^LANE1,bits(v.vx),bits(v.vy),bits(v.spin),i);
+	}
+	h0=hash4(h0,world.score,world.wrong,bits(world.brick_speed),world.tick);
+	h1=hash4(h1^LANE1,world.score,world.wrong,bits(world.brick_speed),world.tick);
+	//the whole generator state, low and high half of each word
+	for(int i=0;i<4;i++){
+		uint32_t lo=world.rng.s[i],hi=world.rng.s[i]>>32;
+		h0=hash4(h0,lo,hi,i,0);
+		h1=hash4(h1^LANE1,lo,hi,i,0);
+	}
+	h0=hash4(h0,world.gameover,0,0,0);
+	h1=hash4(h1^LANE1,world.gameover,0,0,0);
+	return ((uint64_t)h1<<32)|h0;
+}
+
+int Trace::open_out(const char *path)
+{
+	out=fopen(path,"w");
+	if(!out){
+		fprintf(stderr,"Error: cannot write %s\n",path);
+		return 0;
+	}
+	return 1;
+}
+
+int Trace::open_check(const char *path)
+{
+	check=fopen(path,"r");
+	if(!check){
+		fprintf(stderr,"Error: cannot read %s\n",path);
+		return 0;
+	}
+	return 1;
+}
+
+int Trace::tick(unsigned int tick,uint64_t hash)
+{
+	if(out)
+		fprintf(out,"%u %016llx\n",tick,(unsigned long long)hash);
+	if(check && !mismatched){
+		unsigned int t;
+		unsigned long long h;
+		if(fscanf(check,"%u %llx",&t,&h)!=2 || t!=tick || h!=hash){
+			mismatched=1;
+			mismatch_tick=tick;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void Trace::close()
+{
+	if(out)
+		fclose(out);
+	if(check)
+		fclose(check);
+	out=check=NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstdio>
+#include <stdint.h>
+
+struct World;
+
+/* Hash of the whole simulation state. Bricks and bullets are hashed one
+   entity at a time and the results added together, so the value does not
+   depend on which slot an entity lives in and the per-entity loop has no
+   dependency between iterations (the compiler vectorises it). */
+uint64_t world_checksum(const World &world);
+
+/* Per tick checksum stream: one "tick hash" text line per tick.
+   A trace can be written, checked against an earlier one, or both. */
+struct Trace {
+	FILE *out,*check;
+	unsigned int mismatch_tick;
+	int mismatched;
+
+	Trace() : out(NULL), check(NULL), mismatch_tick(0), mismatched(0) {}
+	int open_out(const char *path);
+	int open_check(const char *path);
+	//returns 0 on the first tick that differs from the checked trace
+	int tick(unsigned int tick,uint64_t hash);
+	void close();
+};
+
+#endif
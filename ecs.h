@@ -0,0 +1,217 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Entities stored by archetype.
+
+   An entity is an id plus a set of components. Entities with the same set
+   share an archetype, which keeps each of those components in its own
+   packed column, so a system that only needs transforms and velocities
+   walks just those two arrays and never sees entities without a
+   velocity. Ids are handed out in order from 0 and never reused, not
+   even after destroy(), so callers can use them as indices elsewhere;
+   clear() starts again from 0. */
+
+enum {
+	COMP_TRANSFORM=1,
+	COMP_VELOCITY=2,
+	COMP_COLLIDER=4,
+	COMP_MESH=8,
+	COMP_PREV=16,
+	COMP_COLOUR=32
+};
+
+typedef struct xform{
+	float x;
+	float y;
+	//degrees
+	float rot;
+}xform;
+
+/* Per second */
+typedef struct velocity{
+	float vx;
+	float vy;
+	//degrees
+	float spin;
+}velocity;
+
+/* A segment from x1,y1 (always the left end) to x2,y2 */
+typedef struct collider{
+	float x1;
+	float y1;
+	float x2;
+	float y2;
+	//unit normal
+	float normx;
+	float normy;
+	//spawn lanes it lies across, a bit per lane
+	int lanes;
+}collider;
+
+/* Columns a mask does not include stay empty */
+struct Archetype {
+	int mask;
+	int count;
+	//row -> entity id
+	std::vector<uint32_t> entity;
+	std::vector<xform> xf;
+	std::vector<velocity> vel;
+	std::vector<collider> col;
+	//which of the renderer's meshes draws it
+	std::vector<int> mesh;
+	//transform at the start of the tick, for interpolation
+	std::vector<xform> prev;
+	//brick colour it goes with, 0:black 1:red 2:green
+	std::vector<int> colour;
+};
+
+struct EntityStore {
+	std::vector<Archetype> arch;
+	//entity id -> archetype and row, -1 once destroyed
+	std::vector<int> arch_of;
+	std::vector<int> row_of;
+
+	int size() const
+	{
+		return arch_of.size();
+	}
+
+	/* New entity with the components in mask, value-initialised */
+	uint32_t create(int mask)
+	{
+		int a=0;
+		while(a<(int)arch.size() && arch[a].mask!=mask)
+			a++;
+		if(a==(int)arch.size()){
+			arch.push_back(Archetype());
+			arch[a].mask=mask;
+			arch[a].count=0;
+		}
+		Archetype &t=arch[a];
+		uint32_t e=arch_of.size();
+		arch_of.push_back(a);
+		row_of.push_back(t.count++);
+		t.entity.push_back(e);
+		if(mask&COMP_TRANSFORM)
+			t.xf.push_back(xform());
+		if(mask&COMP_VELOCITY)
+			t.vel.push_back(velocity());
+		if(mask&COMP_COLLIDER)
+			t.col.push_back(collider());
+		if(mask&COMP_MESH)
+			t.mesh.push_back(0);
+		if(mask&COMP_PREV)
+			t.prev.push_back(xform());
+		if(mask&COMP_COLOUR)
+			t.colour.push_back(0);
+		return e;
+	}
+
+	/* Remove entity e. The last row of its archetype moves into its row,
+	   so rows stay packed. */
+	void destroy(uint32_t e)
+	{
+		Archetype &t=arch[arch_of[e]];
+		int r=row_of[e],last=--t.count;
+		uint32_t moved=t.entity[last];
+		swap_pop(t.entity,r);
+		if(t.mask&COMP_TRANSFORM)
+			swap_pop(t.xf,r);
+		if(t.mask&COMP_VELOCITY)
+			swap_pop(t.vel,r);
+		if(t.mask&COMP_COLLIDER)
+			swap_pop(t.col,r);
+		if(t.mask&COMP_MESH)
+			swap_pop(t.mesh,r);
+		if(t.mask&COMP_PREV)
+			swap_pop(t.prev,r);
+		if(t.mask&COMP_COLOUR)
+			swap_pop(t.colour,r);
+		row_of[moved]=r;
+		arch_of[e]=-1;
+		row_of[e]=-1;
+	}
+
+	int alive(uint32_t e) const
+	{
+		return arch_of[e]>=0;
+	}
+
+	void clear()
+	{
+		arch.clear();
+		arch_of.clear();
+		row_of.clear();
+	}
+
+	const xform &xf(uint32_t e) const
+	{
+		return arch[arch_of[e]].xf[row_of[e]];
+	}
+
+	xform &xf(uint32_t e)
+	{
+		return arch[arch_of[e]].xf[row_of[e]];
+	}
+
+	const xform &prev(uint32_t e) const
+	{
+		return arch[arch_of[e]].prev[row_of[e]];
+	}
+
+	const velocity &vel(uint32_t e) const
+	{
+		return arch[arch_of[e]].vel[row_of[e]];
+	}
+
+	velocity &vel(uint32_t e)
+	{
+		return arch[arch_of[e]].vel[row_of[e]];
+	}
+
+	int &mesh(uint32_t e)
+	{
+		return arch[arch_of[e]].mesh[row_of[e]];
+	}
+
+	int colour(uint32_t e) const
+	{
+		return arch[arch_of[e]].colour[row_of[e]];
+	}
+
+	int &colour(uint32_t e)
+	{
+		return arch[arch_of[e]].colour[row_of[e]];
+	}
+
+	const collider &col(uint32_t e) const
+	{
+		return arch[arch_of[e]].col[row_of[e]];
+	}
+
+	collider &col(uint32_t e)
+	{
+		return arch[arch_of[e]].col[row_of[e]];
+	}
+
+	/* Call f(archetype) for every archetype that has all of mask */
+	template<class F> void each(int mask,F f)
+	{
+		for(size_t a=0;a<arch.size();a++)
+			if((arch[a].mask&mask)==mask && arch[a].count)
+				f(arch[a]);
+	}
+
+private:
+	/* Move the last element into v[r] and drop the last */
+	template<class T> static void swap_pop(std::vector<T> &v,int r)
+	{
+		v[r]=v.back();
+		v.pop_back();
+	}
+};
+
+#endif
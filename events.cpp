@@ -0,0 +1,377 @@
+/* Event-driven simulation. Bricks all fall at brick_speed and bullets fly
+   straight at BULLET_SPEED between bounces, so where any of them will be
+   is known in closed form. Instead of moving everything every tick and
+   testing every pair, each brick gets its landing time and each bullet
+   the time of whichever comes first of its next brick hit, the next
+   bounce on its path or exit, looking at most PLAN_AHEAD seconds ahead. Ticks then only run
+   the events that fall inside them.
+
+   A brick's fall at time t is fallen+brick_speed*(t-time)-key, where key
+   is the total fall when it spawned (kept in the lane index). A bullet is
+   at nx,ny + BULLET_SPEED*(t-t0)*dir. */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "world.h"
+
+using namespace std;
+
+//brick fall that puts its bottom on the catch line at -3.9
+#define CATCH_FALL 8.65
+//bullets are only planned this many seconds ahead, which keeps the bricks
+//they have to be tested against to a few lanes. Past PLAN_BRICKS bricks
+//the window shrinks in proportion, down to PLAN_MIN: a plan then tests
+//about as many bricks, though bullets replan more often.
+#define PLAN_AHEAD 0.1
+#define PLAN_MIN 0.01
+#define PLAN_BRICKS 1024
+
+/* Narrow [t0,t1] to the times when p+v*t lies in [lo,hi] */
+static inline int slab(double p,double v,double lo,double hi,double &t0,double &t1)
+{
+	if(v==0)
+		return p>=lo && p<=hi;
+	double a=(lo-p)/v,b=(hi-p)/v;
+	if(a>b)
+		swap(a,b);
+	t0=fmax(t0,a);
+	t1=fmin(t1,b);
+	return t0<=t1;
+}
+
+/* Time after now at which bullet b first touches the brick at dense index
+   i, with the same test as touches(), or -1 if not within horizon */
+double World::hit_time(const bulletshape &b,int i,double now,double horizon) const
+{
+	double r=BULLET_SPEED*(now-b.t0);
+	double tip=b.nx+(r+0.09)*b.dirx,y=b.ny+r*b.diry;
+	double trans=fallen+brick_speed*(now-time)-lanes.key[brick.id[i]];
+	double t0=0,t1=horizon;
+	if(!slab(tip,BULLET_SPEED*b.dirx,brick.x[i]-0.1,brick.x[i]+0.1,t0,t1))
+		return -1;
+	//the bullet has to sit between 4.55-trans and 4.95-trans, and both
+	//its height and the brick's fall change linearly
+	if(!slab(y+trans,BULLET_SPEED*b.diry+brick_speed,4.55,4.95,t0,t1))
+		return -1;
+	return t0;
+}
+
+/* Queue the landing of the brick at dense index i */
+void World::plan_brick(int i)
+{
+	if(brick_speed<=0)
+		return;
+	int id=brick.id[i];
+	double t=time+(CATCH_FALL-(fallen-lanes.key[id]))/brick_speed;
+	events.push(t,TOI_CATCH,id,brick.gen[id],epoch);
+}
+
+/* Whether two bullets fly the same path at the same times, as the
+   bullets of one volley do until one of them is removed */
+static inline int same_flight(const bulletshape &a,const bulletshape &b)
+{
+	return a.t0==b.t0 && a.nx==b.nx && a.ny==b.ny && a.dirx==b.dirx && a.diry==b.diry && a.seg==b.seg && a.segs==b.segs && a.path_end==b.path_end && a.end_mirror==b.end_mirror;
+}
+
+/* Predict the next event of the bullet at dense index j from time now.
+   If like is a bullet with the same flight already planned from now, its
+   prediction is copied instead of testing the bricks again. */
+void World::plan_bullet(int j,double now,int like)
+{
+	bulletshape &b=bullet.b[j];
+	double v=BULLET_SPEED;
+	double r=v*(now-b.t0);
+	double cx=b.nx+r*b.dirx,cy=b.ny+r*b.diry;
+
+	//leaving the field
+	double next=1e30;
+	if(b.dirx>0)
+		next=fmin(next,(FIELD_EDGE-cx)/(v*b.dirx));
+	else if(b.dirx<0)
+		next=fmin(next,(-FIELD_EDGE-cx)/(v*b.dirx));
+	if(b.diry>0)
+		next=fmin(next,(FIELD_EDGE-cy)/(v*b.diry));
+	else if(b.diry<0)
+		next=fmin(next,(-FIELD_EDGE-cy)/(v*b.diry));
+	if(next<0)
+		next=0;
+	int type=TOI_EXIT;
+
+	//the next bounce is already on the path traced when it was fired
+	float end=segend(b);
+	if(end<1e30f){
+		double m=(end-b.path[b.seg].s)/v-(now-b.t0);
+		if(m<next){
+			next=fmax(m,0);
+			type=TOI_MIRROR;
+		}
+	}
+
+	double ahead=PLAN_AHEAD;
+	if(brick.count>PLAN_BRICKS)
+		ahead=fmax(PLAN_AHEAD*PLAN_BRICKS/brick.count,PLAN_MIN);
+	if(next>ahead){
+		next=ahead;
+		type=TOI_AHEAD;
+	}
+
+	//bricks, earliest first and the lowest index on a tie. Candidates are
+	//the lanes the tip sweeps, with keys that put y+trans in [4.55,4.95]
+	//somewhere in the window; y+trans is linear so its ends bound it.
+	double tip0=cx+0.09*b.dirx,tip1=tip0+v*b.dirx*next;
+	double g0=cy+fallen+brick_speed*(now-time);
+	double g1=g0+(v*b.diry+brick_speed)*next;
+
+	//list the bullet under every lane it can reach a brick of before this
+	//plan ends, with some slack for rounding
+	uint32_t h=bullet.handle(j);
+	b.plan++;
+	double k0=fmin(g0,g1)-4.95-1e-9,k1=fmax(g0,g1)-4.55+1e-9;
+	int l1=LaneIndex::lane_at(fmax(tip0,tip1)+0.2);
+	for(int l=LaneIndex::lane_at(fmin(tip0,tip1)-0.2);l<=l1;l++){
+		lanebullet e={h,b.plan,k0,k1};
+		lane_bullets[l].push_back(e);
+		if(lane_bullets[l].size()>2*lane_pruned[l]+64)
+			prune_lane(l);
+	}
+
+	int hit=-1,target=-1;
+	if(like>=0){
+		const bulletshape &l=bullet.b[like];
+		if(l.target>=0)
+			type=TOI_HIT;
+		if(l.target!=b.target)
+			settarget(j,l.target);
+		b.next=l.next;
+		b.version++;
+		events.push(b.next,type,h,b.version,epoch);
+		return;
+	}
+	lanes.query(fmin(tip0,tip1)-0.1,fmax(tip0,tip1)+0.1,k0,k1,[&](int id){
+		int i=brick.index[id];
+		double t=hit_time(b,i,now,next);
+		if(t<0)
+			return;
+		if(t<next || (t==next && (type!=TOI_HIT || i<hit))){
+			next=t;
+			type=TOI_HIT;
+			hit=i;
+			target=id;
+		}
+	});
+	if(target!=b.target)
+		settarget(j,target);
+
+	b.next=now+next;
+	b.version++;
+	events.push(b.next,type,h,b.version,epoch);
+}
+
+/* Aim the bullet at dense index j at brick id, -1 for none */
+void World::settarget(int j,int id)
+{
+	bullet.b[j].target=id;
+	if(id<0)
+		return;
+	if(id>=(int)targeted.size())
+		targeted.resize(id+1);
+	targeted[id].push_back(bullet.handle(j));
+}
+
+/* Drop the stale entries of lane l's bullet list */
+void World::prune_lane(int l)
+{
+	std::vector<lanebullet> &v=lane_bullets[l];
+	size_t n=0;
+	for(size_t e=0;e<v.size();e++){
+		int j=bullet.find(v[e].who);
+		if(j<0 || bullet.b[j].plan!=v[e].plan)
+			continue;
+		v[n++]=v[e];
+	}
+	v.resize(n);
+	lane_pruned[l]=n;
+}
+
+/* A brick has just spawned at dense index i: queue its landing and let any
+   bullet that meets it before its current next event aim for it instead */
+void World::newbrick(int i)
+{
+	plan_brick(i);
+	//only bullets whose plan sweeps the brick's lane and key can meet
+	//it; they are tried in pool order like a scan of every bullet would
+	affected.clear();
+	double key=lanes.key[brick.id[i]];
+	std::vector<lanebullet> &v=lane_bullets[LaneIndex::lane_at(brick.x[i])];
+	for(size_t e=0;e<v.size();e++){
+		if(key<v[e].k0 || key>v[e].k1)
+			continue;
+		int j=bullet.find(v[e].who);
+		if(j>=0 && bullet.b[j].plan==v[e].plan)
+			affected.push_back(j);
+	}
+	sort(affected.begin(),affected.end());
+	for(size_t k=0;k<affected.size();k++){
+		int j=affected[k];
+		bulletshape &b=bullet.b[j];
+		double t=hit_time(b,i,time,b.next-time);
+		if(t<0 || time+t>=b.next)
+			continue;
+		b.next=time+t;
+		settarget(j,brick.id[i]);
+		b.version++;
+		events.push(b.next,TOI_HIT,bullet.handle(j),b.version,epoch);
+	}
+}
+
+/* Brick id is gone; bullets that were going to hit it need a new plan */
+void World::retarget(int id,double now)
+{
+	if(id>=(int)targeted.size())
+		return;
+	affected.clear();
+	std::vector<uint32_t> &by=targeted[id];
+	for(size_t k=0;k<by.size();k++){
+		int j=bullet.find(by[k]);
+		if(j>=0 && bullet.b[j].target==id)
+			affected.push_back(j);
+	}
+	by.clear();
+	//in pool order, as a scan of every bullet would
+	sort(affected.begin(),affected.end());
+	affected.erase(unique(affected.begin(),affected.end()),affected.end());
+	//a volley aimed at the brick replans once, not once per bullet
+	leaders.clear();
+	for(size_t k=0;k<affected.size();k++){
+		int j=affected[k],like=-1;
+		for(size_t q=0;q<leaders.size() && like<0;q++)
+			if(same_flight(bullet.b[leaders[q]],bullet.b[j]))
+				like=leaders[q];
+		plan_bullet(j,now,like);
+		if(like<0)
+			leaders.push_back(j);
+	}
+}
+
+/* Throw away every prediction and make new ones, after the brick speed
+   changes */
+void World::replan(double now)
+{
+	epoch++;
+	events.clear();
+	planned_speed=brick_speed;
+	for(int l=0;l<LANE_COUNT;l++){
+		lane_bullets[l].clear();
+		lane_pruned[l]=0;
+	}
+	targeted.clear();
+	for(int i=0;i<brick.count;i++)
+		plan_brick(i);
+	for(int j=0;j<bullet.count;j++)
+		plan_bullet(j,now);
+}
+
+/* Run every queued event up to time until, in time order */
+void World::run_events(double until)
+{
+	//the last bullet planned, whose plan the rest of its volley can copy
+	//while no brick or bullet has gone since
+	uint32_t lead=0,leadver=0;
+	double leadt=-1;
+	while(!gameover && !events.empty() && events.top().t<=until){
+		toi_event ev=events.top();
+		events.pop();
+		if(ev.epoch!=epoch)
+			continue;
+		if(ev.type==TOI_CATCH){
+			int i=brick.index[ev.who];
+			if(i<0 || brick.gen[ev.who]!=ev.ver)
+				continue;
+			float at=tick_dt>0 ? (ev.t-(time-tick_dt))/tick_dt : 1;
+			if(at<0)
+				at=0;
+			if(at>1)
+				at=1;
+			catchbrick(i,at);
+			retarget(ev.who,ev.t);
+			leadt=-1;
+			continue;
+		}
+		int j=bullet.find(ev.who);
+		if(j<0 || bullet.b[j].version!=ev.ver)
+			continue;
+		bulletshape &b=bullet.b[j];
+		if(ev.type==TOI_EXIT){
+			bullet.remove(j);
+			leadt=-1;
+		}
+		else if(ev.type==TOI_AHEAD || ev.type==TOI_MIRROR){
+			if(ev.type==TOI_MIRROR){
+				b.t0=ev.t;
+				nextseg(b);
+			}
+			int like=-1;
+			if(leadt==ev.t){
+				int l=bullet.find(lead);
+				if(l>=0 && bullet.b[l].version==leadver && same_flight(bullet.b[l],b))
+					like=l;
+			}
+			plan_bullet(j,ev.t,like);
+			if(like<0){
+				lead=ev.who;
+				leadver=b.version;
+				leadt=ev.t;
+			}
+		}
+		else{
+			int id=b.target;
+			bullet.remove(j);
+			shootbrick(brick.index[id]);
+			retarget(id,ev.t);
+			leadt=-1;
+		}
+	}
+}
+
+/* The event-driven version of step(). Per tick it only does constant work
+   plus the events that happen in the tick. */
+void World::step_events(float dt)
+{
+	save_prev_players();
+	tick++;
+	time+=dt;
+	fallen+=brick_speed*dt;
+	if(brick_speed!=planned_speed || epoch==0)
+		replan(time-dt);
+	movemirrors(dt,time-dt);
+	movebaskets(dt);
+	run_timers();
+	fire();
+	run_events(time);
+	if(gameover)
+		return;
+	moveplayer(dt);
+}
+
+/* Write the current positions of bricks and bullets (and where they were
+   a tick ago) into the pools for the renderer and checksums */
+void World::sync()
+{
+	if(!event_driven)
+		return;
+	for(int i=0;i<brick.count;i++){
+		brick.trans[i]=fallen-lanes.key[brick.id[i]];
+		brick.prev[i]=brick.trans[i]-brick_speed*tick_dt;
+	}
+	for(int j=0;j<bullet.count;j++){
+		bulletshape &b=bullet.b[j];
+		float r=BULLET_SPEED*(time-b.t0);
+		float pr=fmax(0,r-BULLET_SPEED*tick_dt);
+		b.rad=r;
+		b.newx=b.nx+r*b.dirx;
+		b.newy=b.ny+r*b.diry;
+		b.prevx=b.nx+pr*b.dirx;
+		b.prevy=b.ny+pr*b.diry;
+	}
+}
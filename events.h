@@ -0,0 +1,85 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+/* What a predicted event does when its time comes */
+enum {
+	TOI_CATCH=0,	//brick reaches the basket line
+	TOI_HIT,	//bullet tip touches a brick
+	TOI_MIRROR,	//bullet reaches the next bounce of its path
+	TOI_EXIT,	//bullet leaves the field
+	TOI_AHEAD	//bullet's planning window ran out; predict again
+};
+
+/* A predicted time of impact. Events are never taken out of the queue
+   when a prediction changes: the entity's version moves on instead and
+   the stale event is dropped when it reaches the front. */
+typedef struct toi_event{
+	double t;
+	//push order, so events at the same time come out in a fixed order
+	uint64_t seq;
+	int type;
+	//bullet handle, or brick id for TOI_CATCH
+	uint32_t who;
+	//bullet version or brick generation when the event was predicted
+	uint32_t ver;
+	//World::epoch when predicted; a new epoch drops every older event
+	uint32_t epoch;
+}toi_event;
+
+/* A bullet whose planned window sweeps a lane, as of its plan-th plan,
+   and the brick keys it can meet there */
+typedef struct lanebullet{
+	uint32_t who;
+	uint32_t plan;
+	double k0,k1;
+}lanebullet;
+
+/* Binary min-heap of events ordered by time */
+struct EventQueue {
+	std::vector<toi_event> heap;
+	uint64_t seq;
+
+	EventQueue() : seq(0) {}
+
+	static bool later(const toi_event &a,const toi_event &b)
+	{
+		if(a.t!=b.t)
+			return a.t>b.t;
+		return a.seq>b.seq;
+	}
+
+	void push(double t,int type,uint32_t who,uint32_t ver,uint32_t epoch)
+	{
+		toi_event ev={t,seq++,type,who,ver,epoch};
+		heap.push_back(ev);
+		std::push_heap(heap.begin(),heap.end(),later);
+	}
+
+	const toi_event &top() const
+	{
+		return heap.front();
+	}
+
+	void pop()
+	{
+		std::pop_heap(heap.begin(),heap.end(),later);
+		heap.pop_back();
+	}
+
+	bool empty() const
+	{
+		return heap.empty();
+	}
+
+	void clear()
+	{
+		heap.clear();
+		seq=0;
+	}
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+/* Uniform grid over the plane, stored as a hash of cells so it has no
+   fixed bounds. Objects are kept up to date one at a time: insert() one
+   with its bounding box, and remove() it with the same box when it goes
+   or moves. Items are plain ints chosen by the caller. An item is listed
+   in every cell its box covers, so a query over several cells may report
+   an item more than once, and may report items that do not overlap;
+   callers always finish with an exact test. */
+
+typedef struct gridentry{
+	int item;
+	int cx,cy;
+}gridentry;
+
+/* Entries hashed to one bucket, oldest first from head. Items mostly go
+   in the order they came, so remove() looks from the oldest and moves the
+   gap to head rather than shifting the rest down. */
+typedef struct gridbucket{
+	int head;
+	std::vector<gridentry> e;
+	gridbucket() : head(0) {}
+}gridbucket;
+
+struct SpatialGrid {
+	float cell;
+	uint32_t mask;
+	//entries listed, and the entries hashed to each bucket
+	int count;
+	std::vector<gridbucket> buckets;
+
+	SpatialGrid() : cell(0.5f), mask(0), count(0) {}
+
+	int cell_of(float v) const
+	{
+		return (int)floor(v/cell);
+	}
+
+	uint32_t bucket(int cx,int cy) const
+	{
+		return ((uint32_t)cx*73856093u ^ (uint32_t)cy*19349663u)&mask;
+	}
+
+	/* Empty the grid and set its cell size. Buckets keep their
+	   allocations for the items that come next. */
+	void clear(float cell_size)
+	{
+		cell=cell_size;
+		if(buckets.empty())
+			buckets.resize(16);
+		for(size_t k=0;k<buckets.size();k++){
+			buckets[k].head=0;
+			buckets[k].e.clear();
+		}
+		mask=buckets.size()-1;
+		count=0;
+	}
+
+	void insert(int item,float x0,float y0,float x1,float y1)
+	{
+		int cx0=cell_of(x0),cx1=cell_of(x1),cy0=cell_of(y0),cy1=cell_of(y1);
+		for(int cy=cy0;cy<=cy1;cy++)
+			for(int cx=cx0;cx<=cx1;cx++){
+				if(count>=2*(int)buckets.size())
+					grow();
+				gridentry e={item,cx,cy};
+				buckets[bucket(cx,cy)].e.push_back(e);
+				count++;
+			}
+	}
+
+	/* Take out an item inserted with this box */
+	void remove(int item,float x0,float y0,float x1,float y1)
+	{
+		int cx0=cell_of(x0),cx1=cell_of(x1),cy0=cell_of(y0),cy1=cell_of(y1);
+		for(int cy=cy0;cy<=cy1;cy++)
+			for(int cx=cx0;cx<=cx1;cx++){
+				gridbucket &b=buckets[bucket(cx,cy)];
+				for(size_t i=b.head;i<b.e.size();i++)
+					if(b.e[i].item==item && b.e[i].cx==cx && b.e[i].cy==cy){
+						b.e[i]=b.e[b.head++];
+						count--;
+						break;
+					}
+				//drop the gap once it is half the bucket
+				if(2*b.head>=(int)b.e.size()){
+					b.e.erase(b.e.begin(),b.e.begin()+b.head);
+					b.head=0;
+				}
+			}
+	}
+
+	/* Call f(item) for items in every cell the box covers */
+	template<class F> void query(float x0,float y0,float x1,float y1,F f) const
+	{
+		if(!count)
+			return;
+		int cx0=cell_of(x0),cx1=cell_of(x1),cy0=cell_of(y0),cy1=cell_of(y1);
+		for(int cy=cy0;cy<=cy1;cy++)
+			for(int cx=cx0;cx<=cx1;cx++){
+				const gridbucket &b=buckets[bucket(cx,cy)];
+				for(size_t i=b.head;i<b.e.size();i++)
+					if(b.e[i].cx==cx && b.e[i].cy==cy)
+						f(b.e[i].item);
+			}
+	}
+
+private:
+	/* Double the buckets and hash every entry again */
+	void grow()
+	{
+		std::vector<gridbucket> old;
+		old.swap(buckets);
+		buckets.resize(2*old.size());
+		mask=buckets.size()-1;
+		for(size_t k=0;k<old.size();k++)
+			for(size_t i=old[k].head;i<old[k].e.size();i++){
+				const gridentry &e=old[k].e[i];
+				buckets[bucket(e.cx,e.cy)].e.push_back(e);
+			}
+	}
+};
+
+#endif
@@ -0,0 +1,652 @@
+/* Runs the game simulation without a window or GL context and reports
+   how many ticks per second the simulation alone sustains. */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "world.h"
+#include "record.h"
+#include "checksum.h"
+#include "grid.h"
+#include "kernels.h"
+#include "level.h"
+#include "jobs.h"
+#include "snapshot.h"
+
+using namespace std;
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n", prog);
+	printf("  --ticks N       number of simulation ticks to run (default 100000)\n");
+	printf("  --rate HZ       simulation ticks per second (default %d)\n", TICK_RATE);
+	printf("  --autofire      hold the fire key for the whole run\n");
+	printf("  --seed N        seed for brick spawning (default 1)\n");
+	printf("  --endless       never end the game (stress runs)\n");
+	printf("  --spawn-interval S  seconds between brick spawns (default 2)\n");
+	printf("  --spawn-count N     bricks per spawn (default 1)\n");
+	printf("  --fire-interval S   seconds between shots (default 1)\n");
+	printf("  --fire-count N      bullets per shot (default 1)\n");
+	printf("  --broadphase brute|lanes|grid  collision candidate search (default lanes)\n");
+	printf("  --threads N     threads for each tick's brick and bullet loops\n");
+	printf("                  (default: one per core)\n");
+	printf("  --events        event-driven simulation from predicted impact times\n");
+	printf("  --mirrors FILE  load the mirrors from FILE (x y angle per line)\n");
+	printf("  --level FILE    play the level FILE (mirrors, spawns and waves)\n");
+	printf("  --bench-bvh     time mirror raycasts from 10 to 10k mirrors\n");
+	printf("  --bench-aim     time the aim preview per frame, traced and cached\n");
+	printf("  --bench-jobs    time a frame's task graph: total work against critical path\n");
+	printf("  --bench-grid    time the spatial grid from 10 to 100k entities\n");
+	printf("  --simd auto|avx2|sse2|scalar  bullet vs brick kernel (default auto)\n");
+	printf("  --bench-simd    time every bullet vs brick kernel the CPU supports\n");
+	printf("  --record FILE   record the input fed to the simulation\n");
+	printf("  --replay FILE   replay a recording as fast as possible\n");
+	printf("  --trace-out FILE    write the state checksum of every tick\n");
+	printf("  --trace-check FILE  compare every tick against a written trace\n");
+}
+
+static Recorder recorder;
+static Trace trace;
+
+//stress settings applied to every new world
+static int endless=0,spawn_count=1,fire_count=1;
+static float spawn_interval=2.0,fire_interval=1.0;
+static int broadphase=BROADPHASE_LANES;
+static int event_driven=0;
+static const char *mirror_path=NULL;
+static Level level;
+static ThreadPool pool;
+static Scheduler jobs;
+
+static int setup(World &world,uint64_t seed)
+{
+	world.init(seed);
+	if(mirror_path && !world.load_mirrors(mirror_path))
+		return 0;
+	world.quiet=1;
+	world.endless=endless;
+	world.spawn_interval=spawn_interval;
+	world.spawn_count=spawn_count;
+	world.fire_interval=fire_interval;
+	world.fire_count=fire_count;
+	world.broadphase=broadphase;
+	world.event_driven=event_driven;
+	world.pool=&pool;
+	//the level file goes last so it overrides the settings above
+	if(level.f && !level.start(world))
+		return 0;
+	return 1;
+}
+
+static void step(World &world,float dt)
+{
+	world.step(dt);
+	if(trace.out || trace.check){
+		world.sync();
+		trace.tick(world.tick,world_checksum(world));
+	}
+}
+
+static void input(World &world,int type,int code,int action)
+{
+	InputEvent ev;
+	memset(&ev,0,sizeof(ev));
+	ev.tick=world.tick;
+	ev.type=type;
+	ev.code=code;
+	ev.action=action;
+	recorder.write(ev);
+	apply_event(world,ev);
+}
+
+static double since(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now()-start).count();
+}
+
+/* Brick sized boxes scattered at one per square unit (the game field holds
+   100 at that density), each tested against its grid neighbours. Prints
+   distinct candidate pairs, exact overlaps and time per tick against brute
+   force, and fails if the overlaps differ from brute force's. Then times
+   the search the game makes, bullets against n bricks, per broadphase. */
+static int bench_grid()
+{
+	int status=0;
+	printf("%9s %12s %12s %10s %12s %10s\n","entities","candidates","overlaps","grid ms","brute pairs","brute ms");
+	for(int n=10;n<=100000;n*=10){
+		Rng rng;
+		rng.seed(n);
+		float side=sqrt((float)n);
+		vector<float> x(n),y(n);
+		for(int i=0;i<n;i++){
+			x[i]=rng.uniform()*side;
+			y[i]=rng.uniform()*side;
+		}
+		SpatialGrid grid;
+		//the query that last reported each entity, since a box over
+		//several cells can report the same one more than once
+		vector<int> seen(n,-1);
+		int stamp=0;
+		long candidates=0,overlaps=0;
+		int reps=n<=1000 ? 1000 : n<=10000 ? 20 : 3;
+		chrono::steady_clock::time_point start=chrono::steady_clock::now();
+		for(int r=0;r<reps;r++){
+			candidates=overlaps=0;
+			grid.clear(GRID_CELL);
+			for(int i=0;i<n;i++)
+				grid.insert(i,x[i]-0.1,y[i]-0.2,x[i]+0.1,y[i]+0.2);
+			for(int i=0;i<n;i++,stamp++)
+				grid.query(x[i]-0.1,y[i]-0.2,x[i]+0.1,y[i]+0.2,[&](int j){
+					if(j<=i || seen[j]==stamp)
+						return;
+					seen[j]=stamp;
+					candidates++;
+					if(fabs(x[i]-x[j])<=0.2 && fabs(y[i]-y[j])<=0.4)
+						overlaps++;
+				});
+		}
+		double grid_ms=since(start)*1000/reps;
+
+		long pairs=(long)n*(n-1)/2;
+		if(n<=10000){
+			long brute=0;
+			reps=n<=1000 ? 100 : 1;
+			start=chrono::steady_clock::now();
+			for(int r=0;r<reps;r++){
+				brute=0;
+				for(int i=0;i<n;i++)
+					for(int j=i+1;j<n;j++)
+						if(fabs(x[i]-x[j])<=0.2 && fabs(y[i]-y[j])<=0.4)
+							brute++;
+			}
+			printf("%9d %12ld %12ld %10.3f %12ld %10.3f\n",n,candidates,overlaps,grid_ms,pairs,since(start)*1000/reps);
+			if(brute!=overlaps){
+				printf("grid found %ld overlaps, brute force %ld\n",overlaps,brute);
+				status=1;
+			}
+		}
+		else
+			printf("%9d %12ld %12ld %10.3f %12ld %10s\n",n,candidates,overlaps,grid_ms,pairs,"-");
+	}
+	if(status)
+		return status;
+
+	//the game's own search: bullets across the field against n falling
+	//bricks, through each broadphase, which must all pick the same brick
+	printf("\n%9s %8s %10s %10s %10s\n","bricks","bullets","grid us","lanes us","brute us");
+	for(int n=1000;n<=100000;n*=10){
+		static World world;
+		world.init(1);
+		Rng rng;
+		rng.seed(n);
+		//spawned as the field falls, so the bricks spread top to bottom
+		for(int i=0;i<n;i++){
+			world.fallen=9.0*i/n;
+			world.createbricks(SPAWN_MIN+(int)rng.bounded(SPAWN_LANES),rng.bounded(3));
+		}
+		world.fallen=9;
+		for(int i=0;i<world.brick.count;i++)
+			world.brick.trans[i]=world.fallen-world.lanes.key[world.brick.id[i]];
+		world.buildgrid();
+		int m=1000;
+		vector<bulletshape> shot(m);
+		for(int i=0;i<m;i++){
+			shot[i].newx=rng.uniform()*10-5;
+			shot[i].newy=rng.uniform()*9-4.5;
+			shot[i].dirx=1;
+			shot[i].diry=0;
+		}
+		int bp[]={BROADPHASE_GRID,BROADPHASE_LANES,BROADPHASE_BRUTE};
+		double us[3];
+		vector<int> first[3];
+		for(int k=0;k<3;k++){
+			world.broadphase=bp[k];
+			int reps=bp[k]==BROADPHASE_BRUTE ? 2 : 200;
+			first[k].resize(m);
+			chrono::steady_clock::time_point start=chrono::steady_clock::now();
+			for(int r=0;r<reps;r++)
+				for(int i=0;i<m;i++)
+					first[k][i]=world.firsthit(shot[i]);
+			us[k]=since(start)*1e6/reps/m;
+		}
+		printf("%9d %8d %10.3f %10.3f %10.3f\n",n,m,us[0],us[1],us[2]);
+		if(first[0]!=first[2] || first[1]!=first[2]){
+			printf("broadphases disagree on the first brick\n");
+			status=1;
+		}
+	}
+	return status;
+}
+
+/* One bullet against n bricks scattered over the field, through each
+   kernel in turn; every kernel must find the same first brick */
+static int bench_simd()
+{
+	int n=100000,reps=2000;
+	Rng rng;
+	rng.seed(1);
+	vector<float> x(n),trans(n);
+	for(int i=0;i<n;i++){
+		x[i]=rng.uniform()*10-5;
+		trans[i]=rng.uniform()*9;
+	}
+	//no brick is this high, so every kernel scans the whole array
+	float tip=0,y=6;
+	int want=-2;
+	printf("%8s %10s %8s\n","kernel","us/scan","first");
+	for(int isa=ISA_SCALAR;isa<=ISA_AVX2;isa++){
+		if(select_touch8(isa)!=isa)
+			continue;
+		int first=0;
+		chrono::steady_clock::time_point start=chrono::steady_clock::now();
+		for(int r=0;r<reps;r++){
+			first=first_touch(x.data(),trans.data(),n,tip,y);
+		}
+		printf("%8s %10.2f %8d\n",isa_name(isa),since(start)*1e6/reps,first);
+		//the last scan also has to agree with one that finds a brick
+		int hit=first_touch(x.data(),trans.data(),n,tip,1);
+		if(want==-2)
+			want=hit;
+		else if(hit!=want){
+			printf("%s found brick %d, scalar found %d\n",isa_name(isa),hit,want);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Random mirrors over a field that grows with their number, raycast by
+   bullets crossing it, through the BVH and by testing every mirror */
+static int bench_bvh()
+{
+	printf("%8s %10s %10s %10s\n","mirrors","bvh us","brute us","agree");
+	for(int n=10;n<=10000;n*=10){
+		static World world;
+		world.init(1);
+		world.mirrors.clear();
+		Rng rng;
+		rng.seed(n);
+		float side=sqrt((float)n)*2;
+		for(int i=0;i<n;i++)
+			world.addmirror(rng.uniform()*side,rng.uniform()*side,rng.uniform()*180);
+		world.buildmirrors();
+		int rays=10000,agree=0;
+		vector<float> ray(4*rays);
+		for(int i=0;i<4*rays;i++)
+			ray[i]=rng.uniform()*side;
+		vector<int> bvh_hit(rays);
+		chrono::steady_clock::time_point start=chrono::steady_clock::now();
+		for(int r=0;r<rays;r++){
+			float t;
+			bvh_hit[r]=world.firstmirror(ray[4*r],ray[4*r+1],ray[4*r+2],ray[4*r+3],-1,t);
+		}
+		double bvh_us=since(start)*1e6/rays;
+		start=chrono::steady_clock::now();
+		for(int r=0;r<rays;r++){
+			int hit=-1;
+			float best=2;
+			for(int j=0;j<n;j++){
+				float t=crossing(world.mirrors.col(j),ray[4*r],ray[4*r+1],ray[4*r+2],ray[4*r+3]);
+				if(t>=0 && t<best){
+					best=t;
+					hit=j;
+				}
+			}
+			agree+=hit==bvh_hit[r];
+		}
+		printf("%8d %10.3f %10.3f %9d%%\n",n,bvh_us,since(start)*1e6/rays,agree*100/rays);
+	}
+	return 0;
+}
+
+/* Aim the canon back and forth across its range at one degree a frame
+   while it slides up and down, and time the preview path per frame when
+   traced every frame, on a first pass that fills the cache and on a
+   second pass over the same aim */
+static int bench_aim()
+{
+	printf("%8s %10s %10s %10s %8s\n","mirrors","trace us","cold us","warm us","cells");
+	for(int n=3;n<=3000;n*=10){
+		static World world;
+		world.init(1);
+		if(n>3){
+			world.mirrors.clear();
+			Rng rng;
+			rng.seed(n);
+			for(int i=0;i<n;i++)
+				world.addmirror(rng.uniform()*8-3.5,rng.uniform()*9-4.5,rng.uniform()*180);
+			world.buildmirrors();
+		}
+		int frames=20000;
+		vector<float> angle(frames),height(frames);
+		for(int f=0;f<frames;f++){
+			int a=f%240;
+			angle[f]=a<120 ? a-60 : 180-a;
+			height[f]=3.4*sin(f*2*M_PI/frames);
+		}
+		chrono::steady_clock::time_point start=chrono::steady_clock::now();
+		float sum=0;
+		for(int f=0;f<frames;f++){
+			bulletshape b;
+			float a=angle[f]*M_PI/180.0f;
+			world.tracepath(b,-4.68,height[f],cos(a),sin(a),0,-1);
+			sum+=b.path_end;
+		}
+		double trace_us=since(start)*1e6/frames;
+		double pass_us[2];
+		for(int pass=0;pass<2;pass++){
+			start=chrono::steady_clock::now();
+			for(int f=0;f<frames;f++)
+				sum+=world.aim.paths[world.aimpreview(angle[f],height[f])].n;
+			pass_us[pass]=since(start)*1e6/frames;
+		}
+		//sum only keeps the loops from being optimised away
+		printf("%8d %10.3f %10.3f %10.3f %8d\n",n,trace_us,pass_us[0],pass_us[1],(int)world.aim.paths.size()+(sum<0));
+	}
+	return 0;
+}
+
+/* Run frames the way sample2D does, as a task graph: two simulation
+   ticks and the state checksum, and per-object render positions built in
+   slices followed by a stand-in for GL submission on the main thread.
+   Serially the positions are of the ticks just run; pipelined they are of
+   a snapshot taken the frame before, so both chains run at once. */
+static void bench_frames(float dt,int pipelined)
+{
+	static World world;
+	world.init(1);
+	world.quiet=1;
+	world.endless=1;
+	world.spawn_interval=0.02;
+	world.spawn_count=400;
+	world.fire_interval=0.01;
+	world.fire_count=20;
+	world.pool=&pool;
+	world.key(KEY_SPACE,ACTION_PRESS,0);
+	static Snapshot snaps[2];
+	int shown=0;
+	take_snapshot(world,0,snaps[shown]);
+	int slices=2*jobs.threads();
+	vector<float> pos;
+	//separate so the checksum and draw tasks can run at once
+	uint64_t sum=0,drawn=0;
+	int frames=600;
+	FrameProfile prof;
+	for(int f=0;f<frames;f++){
+		jobs.clear();
+		const Snapshot &s=snaps[shown];
+		Snapshot &next=snaps[!shown];
+		//serially the frame draws the snapshot the ticks just took
+		const Snapshot &d=pipelined ? s : next;
+		int sim=jobs.add("simulate",[&]{
+			world.step(dt);
+			world.step(dt);
+			take_snapshot(world,0.5,next);
+		});
+		int check=jobs.add("checksum",[&]{
+			sum+=world_checksum(world);
+		});
+		jobs.after(sim,check);
+		int size=jobs.add("size",[&]{
+			pos.resize(2*(d.brick_x.size()+d.bullet.size()));
+		});
+		if(!pipelined)
+			jobs.after(sim,size);
+		vector<int> slice(slices);
+		for(int k=0;k<slices;k++){
+			slice[k]=jobs.add("positions",[&,k]{
+				long n=d.brick_x.size(),m=d.bullet.size();
+				for(int i=n*k/slices;i<n*(k+1)/slices;i++){
+					pos[2*i]=d.brick_x[i];
+					pos[2*i+1]=4.75-(d.brick_prev[i]+d.brick_trans[i])/2;
+				}
+				for(int i=m*k/slices;i<m*(k+1)/slices;i++){
+					const bulletview &b=d.bullet[i];
+					pos[2*(n+i)]=(b.prevx+b.newx)/2;
+					pos[2*(n+i)+1]=(b.prevy+b.newy)/2;
+				}
+			});
+			jobs.after(size,slice[k]);
+		}
+		int draw=jobs.add_main("draw",[&]{
+			for(size_t i=0;i<pos.size();i+=64)
+				drawn+=pos[i]>0;
+		});
+		for(int k=0;k<slices;k++)
+			jobs.after(slice[k],draw);
+		if(!pipelined)
+			jobs.after(check,draw);
+		jobs.run();
+		shown=!shown;
+		//the first frames warm up caches and the brick pools
+		if(f>=frames/10)
+			prof.add(jobs);
+	}
+	printf("%s, threads: %d  bricks: %d  bullets: %d\n",pipelined ? "pipelined" : "serial",jobs.threads(),world.brick.count,world.bullet.count);
+	prof.print();
+	//the sums only keep the tasks from being optimised away
+	if(sum+drawn==1)
+		printf("\n");
+}
+
+static int bench_jobs(float dt)
+{
+	bench_frames(dt,0);
+	bench_frames(dt,1);
+	return 0;
+}
+
+/* Report whether the run matched the checked trace */
+static int trace_result()
+{
+	int failed=trace.mismatched;
+	if(trace.check && failed)
+		printf("trace: MISMATCH at tick %u\n",trace.mismatch_tick);
+	else if(trace.check)
+		printf("trace: match\n");
+	trace.close();
+	return failed;
+}
+
+/* Feed a recording back into a fresh world until it ends or the game does */
+static int replay(World &world,const char *path)
+{
+	Replay rp;
+	InputEvent ev;
+	if(!rp.open(path))
+		return 1;
+	float dt=1.0f/rp.tick_rate;
+	RecordSetup now;
+	if(!setup(world,rp.seed) || !record_setup(world,mirror_path,level.path,now) || !rp.matches(now)){
+		rp.close();
+		return 1;
+	}
+
+	chrono::steady_clock::time_point start=chrono::steady_clock::now();
+	int have=rp.next(ev);
+	while(!world.gameover){
+		while(have && ev.type!=EV_END && ev.tick<=world.tick){
+			apply_event(world,ev);
+			have=rp.next(ev);
+		}
+		if(!have || (ev.type==EV_END && ev.tick<=world.tick))
+			break;
+		step(world,dt);
+	}
+	double secs=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+	rp.close();
+
+	printf("ticks: %u\n",world.tick);
+	printf("score: %d\n",world.score);
+	printf("seconds: %f\n",secs);
+	printf("ticks/sec: %.0f\n",world.tick/secs);
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	long ticks=100000;
+	int rate=TICK_RATE;
+	int autofire=0;
+	uint64_t seed=1;
+	const char *record_path=NULL,*replay_path=NULL;
+	const char *trace_out=NULL,*trace_check=NULL;
+	int bench=0,bench_kernels=0,bench_mirrors=0,bench_preview=0,bench_frame=0;
+	int isa=ISA_AUTO;
+	int threads=thread::hardware_concurrency();
+
+	for(int i=1;i<argc;i++){
+		if(!strcmp(argv[i],"--ticks") && i+1<argc)
+			ticks=atol(argv[++i]);
+		else if(!strcmp(argv[i],"--rate") && i+1<argc)
+			rate=atoi(argv[++i]);
+		else if(!strcmp(argv[i],"--seed") && i+1<argc)
+			seed=strtoull(argv[++i],NULL,0);
+		else if(!strcmp(argv[i],"--endless"))
+			endless=1;
+		else if(!strcmp(argv[i],"--spawn-interval") && i+1<argc)
+			spawn_interval=atof(argv[++i]);
+		else if(!strcmp(argv[i],"--spawn-count") && i+1<argc)
+			spawn_count=atoi(argv[++i]);
+		else if(!strcmp(argv[i],"--fire-interval") && i+1<argc)
+			fire_interval=atof(argv[++i]);
+		else if(!strcmp(argv[i],"--fire-count") && i+1<argc)
+			fire_count=atoi(argv[++i]);
+		else if(!strcmp(argv[i],"--broadphase") && i+1<argc){
+			i++;
+			if(!strcmp(argv[i],"brute"))
+				broadphase=BROADPHASE_BRUTE;
+			else if(!strcmp(argv[i],"lanes"))
+				broadphase=BROADPHASE_LANES;
+			else if(!strcmp(argv[i],"grid"))
+				broadphase=BROADPHASE_GRID;
+			else{
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i],"--threads") && i+1<argc)
+			threads=atoi(argv[++i]);
+		else if(!strcmp(argv[i],"--events"))
+			event_driven=1;
+		else if(!strcmp(argv[i],"--mirrors") && i+1<argc)
+			mirror_path=argv[++i];
+		else if(!strcmp(argv[i],"--level") && i+1<argc){
+			if(!level.open(argv[++i]))
+				return 1;
+		}
+		else if(!strcmp(argv[i],"--bench-bvh"))
+			bench_mirrors=1;
+		else if(!strcmp(argv[i],"--bench-aim"))
+			bench_preview=1;
+		else if(!strcmp(argv[i],"--bench-jobs"))
+			bench_frame=1;
+		else if(!strcmp(argv[i],"--bench-grid"))
+			bench=1;
+		else if(!strcmp(argv[i],"--simd") && i+1<argc){
+			i++;
+			if(!strcmp(argv[i],"auto"))
+				isa=ISA_AUTO;
+			else if(!strcmp(argv[i],"avx2"))
+				isa=ISA_AVX2;
+			else if(!strcmp(argv[i],"sse2"))
+				isa=ISA_SSE2;
+			else if(!strcmp(argv[i],"scalar"))
+				isa=ISA_SCALAR;
+			else{
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i],"--bench-simd"))
+			bench_kernels=1;
+		else if(!strcmp(argv[i],"--autofire"))
+			autofire=1;
+		else if(!strcmp(argv[i],"--record") && i+1<argc)
+			record_path=argv[++i];
+		else if(!strcmp(argv[i],"--replay") && i+1<argc)
+			replay_path=argv[++i];
+		else if(!strcmp(argv[i],"--trace-out") && i+1<argc)
+			trace_out=argv[++i];
+		else if(!strcmp(argv[i],"--trace-check") && i+1<argc)
+			trace_check=argv[++i];
+		else{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(rate<=0){
+		usage(argv[0]);
+		return 1;
+	}
+	float dt=1.0f/rate;
+	pool.start(threads);
+	jobs.start(threads);
+
+	if(bench)
+		return bench_grid();
+	if(bench_kernels)
+		return bench_simd();
+	if(bench_mirrors)
+		return bench_bvh();
+	if(bench_preview)
+		return bench_aim();
+	if(bench_frame)
+		return bench_jobs(dt);
+	int chosen=select_touch8(isa);
+	if(isa!=ISA_AUTO && chosen!=isa)
+		printf("simd: %s not supported, using %s\n",isa_name(isa),isa_name(chosen));
+	if(trace_out && !trace.open_out(trace_out))
+		return 1;
+	if(trace_check && !trace.open_check(trace_check))
+		return 1;
+
+	static World world;
+	if(replay_path)
+		return replay(world,replay_path) || trace_result();
+
+	if(!setup(world,seed))
+		return 1;
+	if(record_path){
+		RecordSetup rs;
+		if(!record_setup(world,mirror_path,level.path,rs) || !recorder.open(record_path,rate,seed,rs))
+			return 1;
+	}
+	if(autofire)
+		input(world,EV_KEY,KEY_SPACE,ACTION_PRESS);
+
+	int games=1;
+	chrono::steady_clock::time_point start=chrono::steady_clock::now();
+	long t;
+	for(t=0;t<ticks;t++){
+		step(world,dt);
+		if(world.gameover){
+			//a recording covers a single game
+			if(record_path){
+				t++;
+				break;
+			}
+			//start a new game so long soak runs keep measuring
+			setup(world,seed+games);
+			if(autofire)
+				input(world,EV_KEY,KEY_SPACE,ACTION_PRESS);
+			games++;
+		}
+	}
+	double secs=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+	recorder.close(world.tick);
+
+	printf("ticks: %ld\n",t);
+	printf("games: %d\n",games);
+	printf("score: %d\n",world.score);
+	printf("bricks: %d\n",world.brick.count);
+	printf("bullets: %d\n",world.bullet.count);
+	printf("seconds: %f\n",secs);
+	printf("ticks/sec: %.0f\n",t/secs);
+	return trace_result();
+}
@@ -0,0 +1,426 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Work-stealing scheduler for the task graph of one frame.
+
+   A frame is a list of tasks and the tasks each one waits for. run()
+   starts every task with nothing to wait for and returns once all have
+   finished. Each thread keeps its own deque: it pushes the tasks it makes
+   ready to the back and takes from the back, so a task's successors tend
+   to run on the thread whose cache has its data, and an idle thread
+   steals from the front of the others. Tasks added with add_main() only
+   run on the thread calling run(), for work such as GL calls that is tied
+   to it.
+
+   Every task is timed, so after run() the frame's total work can be set
+   against its critical path: the longest chain of tasks that had to run
+   one after another, which is as short as the frame can get however many
+   threads there are.
+
+   Work that blocks for long outside any frame, such as playing a sound,
+   goes to a SerialQueue instead, which has a thread of its own. */
+
+struct Task {
+	const char *name;
+	std::function<void()> f;
+	//tasks that wait for this one
+	std::vector<int> next;
+	//number of tasks this one waits for
+	int deps;
+	int main;
+	//thread that ran it (0 is the one calling run()) and when, in
+	//seconds from the start of run()
+	int worker;
+	double start,end;
+};
+
+struct Scheduler {
+	std::vector<Task> tasks;
+
+	Scheduler() : queued(0), left(0), running(false), quit(false), elapsed(0) {}
+
+	~Scheduler()
+	{
+		stop();
+	}
+
+	/* threads counts the thread calling run(), so 1 runs everything
+	   there */
+	void start(int threads)
+	{
+		stop();
+		quit=false;
+		queues.clear();
+		for(int i=0;i<(threads>1 ? threads : 1);i++)
+			queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		for(int i=1;i<threads;i++)
+			workers.push_back(std::thread([this,i]{ work(i); }));
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m);
+			quit=true;
+		}
+		wake.notify_all();
+		for(size_t i=0;i<workers.size();i++)
+			workers[i].join();
+		workers.clear();
+	}
+
+	int threads() const
+	{
+		return workers.size()+1;
+	}
+
+	/* Add a task to the frame; returns its number for after() */
+	int add(const char *name,std::function<void()> f)
+	{
+		Task t;
+		t.name=name;
+		t.f=f;
+		t.deps=0;
+		t.main=0;
+		t.worker=-1;
+		t.start=t.end=0;
+		tasks.push_back(t);
+		return tasks.size()-1;
+	}
+
+	int add_main(const char *name,std::function<void()> f)
+	{
+		int i=add(name,f);
+		tasks[i].main=1;
+		return i;
+	}
+
+	/* Make task wait for first. A task can only wait for tasks added
+	   before it, which also keeps the graph free of cycles. */
+	void after(int first,int task)
+	{
+		if(first<0 || first>=task)
+			return;
+		tasks[first].next.push_back(task);
+		tasks[task].deps++;
+	}
+
+	/* Drop the tasks so the next frame can be built */
+	void clear()
+	{
+		tasks.clear();
+	}
+
+	void run()
+	{
+		int n=tasks.size();
+		if(!n)
+			return;
+		waiting.reset(new std::atomic<int>[n]);
+		for(int i=0;i<n;i++)
+			waiting[i]=tasks[i].deps;
+		left=n;
+		t0=std::chrono::steady_clock::now();
+		{
+			std::lock_guard<std::mutex> lock(m);
+			running=true;
+		}
+		//spread the first tasks over the threads
+		int w=0;
+		for(int i=0;i<n;i++)
+			if(!tasks[i].deps)
+				ready(i,w++%queues.size());
+		int i;
+		for(;;){
+			if(take(0,i)){
+				execute(i,0);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m);
+			wake.wait(lock,[&]{ return left==0 || queued>0 || !main_ready.empty(); });
+			if(left==0)
+				break;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m);
+			running=false;
+		}
+		elapsed=seconds();
+	}
+
+	/* Timings of the last run(), in seconds: wall time, the sum of all
+	   task times and the longest chain of dependent tasks */
+	double wall() const
+	{
+		return elapsed;
+	}
+
+	double work() const
+	{
+		double w=0;
+		for(size_t i=0;i<tasks.size();i++)
+			w+=tasks[i].end-tasks[i].start;
+		return w;
+	}
+
+	double critical_path() const
+	{
+		//tasks only wait for earlier ones, so index order is a
+		//topological order
+		std::vector<double> until(tasks.size(),0);
+		double longest=0;
+		for(size_t i=0;i<tasks.size();i++){
+			double done=until[i]+tasks[i].end-tasks[i].start;
+			for(size_t k=0;k<tasks[i].next.size();k++)
+				if(until[tasks[i].next[k]]<done)
+					until[tasks[i].next[k]]=done;
+			if(longest<done)
+				longest=done;
+		}
+		return longest;
+	}
+
+private:
+	struct Queue {
+		std::mutex m;
+		std::deque<int> q;
+	};
+	std::vector<std::unique_ptr<Queue> > queues;
+	std::vector<std::thread> workers;
+	//guards running, quit and main_ready, and is what idle threads
+	//sleep on
+	std::mutex m;
+	std::condition_variable wake;
+	//tasks sitting in the deques, and tasks of the frame not yet done
+	std::atomic<int> queued,left;
+	std::unique_ptr<std::atomic<int>[]> waiting;
+	std::deque<int> main_ready;
+	bool running,quit;
+	std::chrono::steady_clock::time_point t0;
+	double elapsed;
+
+	double seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+	}
+
+	/* Task i has nothing left to wait for; w is the thread that freed it */
+	void ready(int i,int w)
+	{
+		if(tasks[i].main){
+			std::lock_guard<std::mutex> lock(m);
+			main_ready.push_back(i);
+		}
+		else{
+			{
+				std::lock_guard<std::mutex> lock(queues[w]->m);
+				queues[w]->q.push_back(i);
+			}
+			queued++;
+			//taking the lock orders this with a thread about to sleep
+			std::lock_guard<std::mutex> lock(m);
+		}
+		wake.notify_all();
+	}
+
+	/* Next task for thread w: its own newest, else the oldest of another */
+	bool take(int w,int &i)
+	{
+		if(w==0){
+			std::lock_guard<std::mutex> lock(m);
+			if(!main_ready.empty()){
+				i=main_ready.front();
+				main_ready.pop_front();
+				return true;
+			}
+		}
+		if(queued==0)
+			return false;
+		for(size_t k=0;k<queues.size();k++){
+			Queue &q=*queues[(w+k)%queues.size()];
+			std::lock_guard<std::mutex> lock(q.m);
+			if(q.q.empty())
+				continue;
+			if(k==0){
+				i=q.q.back();
+				q.q.pop_back();
+			}
+			else{
+				i=q.q.front();
+				q.q.pop_front();
+			}
+			queued--;
+			return true;
+		}
+		return false;
+	}
+
+	void execute(int i,int w)
+	{
+		Task &t=tasks[i];
+		t.worker=w;
+		t.start=seconds();
+		t.f();
+		t.end=seconds();
+		for(size_t k=0;k<t.next.size();k++)
+			if(--waiting[t.next[k]]==0)
+				ready(t.next[k],w);
+		if(--left==0){
+			std::lock_guard<std::mutex> lock(m);
+			wake.notify_all();
+		}
+	}
+
+	void work(int w)
+	{
+		for(;;){
+			{
+				std::unique_lock<std::mutex> lock(m);
+				wake.wait(lock,[&]{ return quit || (running && queued>0); });
+				if(quit)
+					return;
+			}
+			int i;
+			while(take(w,i))
+				execute(i,w);
+		}
+	}
+};
+
+/* Jobs run one at a time, in the order they were posted, on a thread that
+   frame tasks never use, so a job that blocks (a sound plays for as long
+   as the clip lasts) holds up neither a frame nor its workers. At most
+   limit jobs wait their turn; post() drops any more, so a burst of sounds
+   cannot leave a backlog that plays long after the fact. */
+struct SerialQueue {
+	SerialQueue() : limit(0), quit(false) {}
+
+	~SerialQueue()
+	{
+		stop();
+	}
+
+	void start(size_t waiting)
+	{
+		stop();
+		limit=waiting;
+		quit=false;
+		worker=std::thread([this]{ work(); });
+	}
+
+	void stop()
+	{
+		if(!worker.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m);
+			quit=true;
+			jobs.clear();
+		}
+		wake.notify_all();
+		worker.join();
+	}
+
+	/* Queue f; returns false if it was dropped */
+	bool post(std::function<void()> f)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m);
+			if(!worker.joinable() || jobs.size()>=limit)
+				return false;
+			jobs.push_back(f);
+		}
+		wake.notify_one();
+		return true;
+	}
+
+private:
+	std::thread worker;
+	//guards jobs and quit
+	std::mutex m;
+	std::condition_variable wake;
+	std::deque<std::function<void()> > jobs;
+	size_t limit;
+	bool quit;
+
+	void work()
+	{
+		for(;;){
+			std::function<void()> f;
+			{
+				std::unique_lock<std::mutex> lock(m);
+				wake.wait(lock,[&]{ return quit || !jobs.empty(); });
+				if(quit)
+					return;
+				f=jobs.front();
+				jobs.pop_front();
+			}
+			f();
+		}
+	}
+};
+
+/* Task and frame times of Scheduler runs, summed over frames so they can
+   be reported as averages. Tasks with the same name, such as the slices
+   of one job, are reported together. */
+struct FrameProfile {
+	std::vector<const char *> names;
+	std::vector<double> task;
+	double wall,work,critical;
+	int frames;
+
+	FrameProfile()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		names.clear();
+		task.clear();
+		wall=work=critical=0;
+		frames=0;
+	}
+
+	void add(const Scheduler &s)
+	{
+		for(size_t t=0;t<s.tasks.size();t++){
+			size_t k=0;
+			while(k<names.size() && strcmp(names[k],s.tasks[t].name))
+				k++;
+			if(k==names.size()){
+				names.push_back(s.tasks[t].name);
+				task.push_back(0);
+			}
+			task[k]+=s.tasks[t].end-s.tasks[t].start;
+		}
+		wall+=s.wall();
+		work+=s.work();
+		critical+=s.critical_path();
+		frames++;
+	}
+
+	/* Averages per frame in milliseconds */
+	void print() const
+	{
+		if(!frames)
+			return;
+		for(size_t k=0;k<names.size();k++)
+			printf("  %-10s %8.3f ms\n",names[k],task[k]*1000/frames);
+		printf("frame ms: %.3f  work ms: %.3f  critical path ms: %.3f\n",wall*1000/frames,work*1000/frames,critical*1000/frames);
+	}
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+static uint32_t touch8_scalar(const float *x,const float *trans,float tip,float y)
+{
+	uint32_t mask=0;
+	for(int i=0;i<8;i++)
+		mask|=touches(x[i],trans[i],tip,y)<<i;
+	return mask;
+}
+
+#ifdef HAVE_X86
+__attribute__((target("sse2")))
+static uint32_t touch8_sse2(const float *x,const float *trans,float tip,float y)
+{
+	__m128 vtip=_mm_set1_ps(tip),vy=_mm_set1_ps(y);
+	__m128 d=_mm_set1_ps(0.1f),lo=_mm_set1_ps(4.55f),hi=_mm_set1_ps(4.95f);
+	uint32_t mask=0;
+	for(int k=0;k<8;k+=4){
+		__m128 vx=_mm_loadu_ps(x+k),vt=_mm_loadu_ps(trans+k);
+		__m128 in=_mm_and_ps(_mm_cmpge_ps(vtip,_mm_sub_ps(vx,d)),_mm_cmple_ps(vtip,_mm_add_ps(vx,d)));
+		in=_mm_and_ps(in,_mm_cmpge_ps(vy,_mm_sub_ps(lo,vt)));
+		in=_mm_and_ps(in,_mm_cmple_ps(vy,_mm_sub_ps(hi,vt)));
+		mask|=_mm_movemask_ps(in)<<k;
+	}
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static uint32_t touch8_avx2(const float *x,const float *trans,float tip,float y)
+{
+	__m256 vtip=_mm256_set1_ps(tip),vy=_mm256_set1_ps(y);
+	__m256 vx=_mm256_loadu_ps(x),vt=_mm256_loadu_ps(trans);
+	__m256 d=_mm256_set1_ps(0.1f);
+	__m256 in=_mm256_and_ps(_mm256_cmp_ps(vtip,_mm256_sub_ps(vx,d),_CMP_GE_OQ),_mm256_cmp_ps(vtip,_mm256_add_ps(vx,d),_CMP_LE_OQ));
+	in=_mm256_and_ps(in,_mm256_cmp_ps(vy,_mm256_sub_ps(_mm256_set1_ps(4.55f),vt),_CMP_GE_OQ));
+	in=_mm256_and_ps(in,_mm256_cmp_ps(vy,_mm256_sub_ps(_mm256_set1_ps(4.95f),vt),_CMP_LE_OQ));
+	return _mm256_movemask_ps(in);
+}
+#endif
+
+touch8_fn touch8=touch8_scalar;
+
+int select_touch8(int isa)
+{
+#ifdef HAVE_X86
+	__builtin_cpu_init();
+	int avx2=__builtin_cpu_supports("avx2");
+	int sse2=__builtin_cpu_supports("sse2");
+	if(isa==ISA_AUTO)
+		isa=avx2 ? ISA_AVX2 : sse2 ? ISA_SSE2 : ISA_SCALAR;
+	if(isa==ISA_AVX2 && avx2){
+		touch8=touch8_avx2;
+		return ISA_AVX2;
+	}
+	if(isa>=ISA_SSE2 && sse2){
+		touch8=touch8_sse2;
+		return ISA_SSE2;
+	}
+#endif
+	touch8=touch8_scalar;
+	return ISA_SCALAR;
+}
+
+const char *isa_name(int isa)
+{
+	switch(isa){
+		case ISA_SSE2:
+			return "sse2";
+		case ISA_AVX2:
+			return "avx2";
+		case ISA_SCALAR:
+			return "scalar";
+		default:
+			return "auto";
+	}
+}
+
+int first_touch(const float *x,const float *trans,int n,float tip,float y)
+{
+	int i=0;
+	for(;i+8<=n;i+=8){
+		uint32_t mask=touch8(x+i,trans+i,tip,y);
+		if(mask)
+			return i+__builtin_ctz(mask);
+	}
+	for(;i<n;i++)
+		if(touches(x[i],trans[i],tip,y))
+			return i;
+	return -1;
+}
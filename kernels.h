@@ -0,0 +1,34 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+
+/* Does a bullet whose tip is at x=tip and whose centre is at height y
+   touch a brick centred at x whose top has fallen trans from 4.95.
+   Everything is float so the vector kernels give the same answers. */
+static inline int touches(float x,float trans,float tip,float y)
+{
+	return tip>=x-0.1f && tip<=x+0.1f && y>=4.55f-trans && y<=4.95f-trans;
+}
+
+/* Bit i of the result is set when the bullet touches brick i of the 8
+   bricks starting at x and trans */
+typedef uint32_t (*touch8_fn)(const float *x,const float *trans,float tip,float y);
+
+enum {
+	ISA_AUTO=0,
+	ISA_SCALAR,
+	ISA_SSE2,
+	ISA_AVX2
+};
+
+/* Pick the touch8 kernel; ISA_AUTO takes the best one the CPU supports.
+   Returns the ISA actually chosen. */
+int select_touch8(int isa);
+const char *isa_name(int isa);
+extern touch8_fn touch8;
+
+/* Index of the first of n bricks the bullet touches, or -1 */
+int first_touch(const float *x,const float *trans,int n,float tip,float y);
+
+#endif
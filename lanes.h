@@ -0,0 +1,132 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include <cmath>
+#include <vector>
+
+/* Bricks bucketed by the lane (integer x) they fall in.
+
+   Every brick falls at the same speed, so a brick's height only depends
+   on how far the whole field has fallen since it spawned. Each entry
+   stores that total fall at spawn time as its key; keys only grow as
+   bricks spawn, so appending keeps every lane sorted by height and a
+   height range becomes a binary search on keys. Removed entries are
+   left behind as tombstones (id -1) and swept out once they pile up;
+   each brick's place in its lane is kept so removing one, even among the
+   many of a burst that share a key, costs no search. */
+
+#define LANE_MIN -5
+#define LANE_COUNT 11
+
+struct LaneEntry {
+	double key;
+	int id;
+};
+
+struct Lane {
+	std::vector<LaneEntry> e;
+	int head,dead;
+};
+
+struct LaneIndex {
+	Lane lane[LANE_COUNT];
+	//by brick id
+	std::vector<double> key;
+	std::vector<int> lane_of,pos;
+
+	LaneIndex()
+	{
+		clear();
+	}
+
+	static int lane_at(float x)
+	{
+		int l=(int)floor(x+0.5f)-LANE_MIN;
+		if(l<0)
+			return 0;
+		if(l>=LANE_COUNT)
+			return LANE_COUNT-1;
+		return l;
+	}
+
+	void add(int id,float x,double k)
+	{
+		if(id>=(int)key.size()){
+			key.resize(id+1);
+			lane_of.resize(id+1);
+			pos.resize(id+1);
+		}
+		int l=lane_at(x);
+		LaneEntry en={k,id};
+		pos[id]=lane[l].e.size();
+		lane[l].e.push_back(en);
+		key[id]=k;
+		lane_of[id]=l;
+	}
+
+	void remove(int id)
+	{
+		Lane &ln=lane[lane_of[id]];
+		ln.e[pos[id]].id=-1;
+		ln.dead++;
+		//the oldest bricks leave first, so usually this just moves head
+		while(ln.head<(int)ln.e.size() && ln.e[ln.head].id<0){
+			ln.head++;
+			ln.dead--;
+		}
+		if(ln.head+ln.dead>(int)ln.e.size()/2 && ln.e.size()>32)
+			compact(ln,pos);
+	}
+
+	void clear()
+	{
+		for(int l=0;l<LANE_COUNT;l++){
+			lane[l].e.clear();
+			lane[l].head=lane[l].dead=0;
+		}
+		key.clear();
+		lane_of.clear();
+		pos.clear();
+	}
+
+	/* Call f(id) for every brick whose lane covers x in [x0,x1] and whose
+	   key lies in [k0,k1] */
+	template<class F> void query(float x0,float x1,double k0,double k1,F f) const
+	{
+		int l1=lane_at(x1);
+		for(int l=lane_at(x0);l<=l1;l++){
+			const Lane &ln=lane[l];
+			for(int i=lower(ln,k0);i<(int)ln.e.size() && ln.e[i].key<=k1;i++)
+				if(ln.e[i].id>=0)
+					f(ln.e[i].id);
+		}
+	}
+
+	/* First live or dead entry at or after head with key >= k */
+	static int lower(const Lane &ln,double k)
+	{
+		int lo=ln.head,hi=ln.e.size();
+		while(lo<hi){
+			int mid=(lo+hi)/2;
+			if(ln.e[mid].key<k)
+				lo=mid+1;
+			else
+				hi=mid;
+		}
+		return lo;
+	}
+
+	static void compact(Lane &ln,std::vector<int> &pos)
+	{
+		int n=0;
+		for(int i=ln.head;i<(int)ln.e.size();i++)
+			if(ln.e[i].id>=0){
+				pos[ln.e[i].id]=n;
+				ln.e[n++]=ln.e[i];
+			}
+		ln.e.resize(n);
+		ln.head=ln.dead=0;
+	}
+};
+
+#endif
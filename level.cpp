@@ -0,0 +1,158 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "level.h"
+#include "world.h"
+
+using namespace std;
+
+/* Colour letters as brick colours: k black, r red, g green */
+static int colour_of(char c)
+{
+	switch(c){
+		case 'k':
+			return 0;
+		case 'r':
+			return 1;
+		case 'g':
+			return 2;
+	}
+	return -1;
+}
+
+int Level::open(const char *path)
+{
+	f=fopen(path,"r");
+	if(!f){
+		fprintf(stderr,"Error: cannot read %s\n",path);
+		return 0;
+	}
+	this->path=path;
+	return 1;
+}
+
+int Level::read(LevelEntry &e)
+{
+	char buf[256];
+	while(fgets(buf,sizeof(buf),f)){
+		line++;
+		char *p=buf;
+		while(*p==' ' || *p=='\t')
+			p++;
+		if(*p=='#' || *p=='\n' || *p=='\r' || !*p)
+			continue;
+		e.t=-1;
+		if(*p=='@'){
+			char *end;
+			e.t=strtod(p+1,&end);
+			if(end==p+1 || e.t<0){
+				fprintf(stderr,"Error: %s:%d: bad time\n",path,line);
+				return -1;
+			}
+			p=end;
+		}
+		char cmd[16],col[8]="";
+		e.vx=e.vy=e.spin=0;
+		int n=sscanf(p,"%15s %f %f %f %f %f %f",cmd,&e.a,&e.b,&e.c,&e.vx,&e.vy,&e.spin);
+		if(n>=1 && !strcmp(cmd,"mirror") && (n==4 || n==7))
+			e.type=LV_MIRROR;
+		else if(n>=1 && !strcmp(cmd,"spawn") && sscanf(p,"%*s %f %f %7s",&e.a,&e.b,col)>=2 && e.a>0 && e.b>=0){
+			e.type=LV_SPAWN;
+			e.colours=col[0] ? 0 : 7;
+			for(char *c=col;*c;c++){
+				if(colour_of(*c)<0){
+					fprintf(stderr,"Error: %s:%d: colours are k, r and g\n",path,line);
+					return -1;
+				}
+				e.colours|=1<<colour_of(*c);
+			}
+		}
+		else if(n>=1 && !strcmp(cmd,"brick") && sscanf(p,"%*s %f %7s",&e.a,col)==2 && fabs(e.a)<=4.5 && !col[1] && colour_of(col[0])>=0){
+			e.type=LV_BRICK;
+			e.b=colour_of(col[0]);
+		}
+		else if(n>=2 && !strcmp(cmd,"speed") && e.a>0)
+			e.type=LV_SPEED;
+		else{
+			fprintf(stderr,"Error: %s:%d: unknown or malformed entry\n",path,line);
+			return -1;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+/* mirrors counts mirror entries in the current batch; the caller builds
+   the mirror index once the batch is done */
+void Level::apply(World &world,const LevelEntry &e,int &mirrors)
+{
+	switch(e.type){
+		case LV_MIRROR:
+			world.addmirror(e.a,e.b,e.c,e.vx,e.vy,e.spin);
+			mirrors++;
+			break;
+		case LV_SPAWN:
+			world.spawn_interval=e.a;
+			world.spawn_count=(int)e.b;
+			world.spawn_colours=e.colours;
+			break;
+		case LV_BRICK:
+			world.createbricks(e.a,(int)e.b);
+			break;
+		case LV_SPEED:
+			world.brick_speed=e.a;
+			break;
+	}
+}
+
+int Level::start(World &world)
+{
+	rewind(f);
+	line=0;
+	has_next=0;
+	int mirrors=0,r;
+	LevelEntry e;
+	while((r=read(e))>0){
+		if(e.t>=0){
+			next=e;
+			has_next=1;
+			break;
+		}
+		//the level's mirrors replace the default ones
+		if(e.type==LV_MIRROR && !mirrors)
+			world.mirrors.clear();
+		apply(world,e,mirrors);
+	}
+	if(mirrors)
+		world.buildmirrors();
+	world.level=this;
+	return r>=0;
+}
+
+void Level::advance(World &world)
+{
+	int mirrors=0;
+	while(has_next && world.tick_at(next.t)<=world.tick){
+		apply(world,next,mirrors);
+		LevelEntry e;
+		int r=read(e);
+		if(r>0 && e.t<next.t){
+			fprintf(stderr,"Error: %s:%d: %s entry out of time order\n",path,line,e.t<0 ? "untimed" : "timed");
+			r=-1;
+		}
+		//a bad line ends the level; the game goes on as it is
+		has_next=r>0;
+		if(has_next)
+			next=e;
+	}
+	if(mirrors)
+		world.buildmirrors();
+}
+
+void Level::close()
+{
+	if(f)
+		fclose(f);
+	f=NULL;
+}
@@ -0,0 +1,66 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <cstdio>
+
+struct World;
+
+/* Level files are plain text, one entry per line; # starts a comment.
+
+	mirror X Y ANGLE [VX VY SPIN]	add a mirror (the first one replaces the
+					default mirrors), sliding VX,VY and
+					turning SPIN degrees per second
+	spawn INTERVAL COUNT [COLOURS]	spawn COUNT bricks every INTERVAL seconds,
+					colours picked from COLOURS (any of k r g
+					for black, red, green; all three if left out)
+	brick X COLOUR			spawn one brick now at x X
+	speed V				set the brick speed
+
+   An entry may start with @T to happen T seconds into the game instead of
+   at the start; timed entries come after the others, in time order. Only
+   the next timed entry is held in memory, and the rest of the file is
+   read as the game gets to it, so a level can be arbitrarily long. */
+
+enum {
+	LV_MIRROR=1,
+	LV_SPAWN,
+	LV_BRICK,
+	LV_SPEED
+};
+
+struct LevelEntry {
+	//seconds into the game, -1 at the start
+	double t;
+	int type;
+	//mirror x y angle, spawn interval count, brick x colour, speed v
+	float a,b,c;
+	//mirror slide and spin
+	float vx,vy,spin;
+	//spawn colours as a bit per brick colour
+	int colours;
+};
+
+struct Level {
+	FILE *f;
+	const char *path;
+	int line;
+	//next timed entry, read ahead so its time is known
+	LevelEntry next;
+	int has_next;
+
+	Level() : f(NULL), path(NULL), line(0), has_next(0) {}
+	int open(const char *path);
+	/* Apply the untimed entries to a freshly initialised world and read up
+	   to the first timed one; 0 on error */
+	int start(World &world);
+	/* Apply the timed entries due by the world's current tick */
+	void advance(World &world);
+	void close();
+
+private:
+	//1 for an entry, 0 at end of file, -1 on error
+	int read(LevelEntry &e);
+	void apply(World &world,const LevelEntry &e,int &mirrors);
+};
+
+#endif
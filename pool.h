@@ -0,0 +1,124 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads for data-parallel loops.
+
+   parallel_for() cuts [0,n) into chunks of grain items and runs them on
+   the workers and the calling thread, returning once all are done. Each
+   chunk gets its number, so results written per chunk can be merged in
+   chunk order and come out the same however the chunks were scheduled. */
+
+struct ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex m;
+	std::condition_variable wake,finished;
+	//the loop being run: body, item count, chunk size and chunk counters
+	std::function<void(int,int,int)> body;
+	int n,grain,chunks;
+	std::atomic<int> next_chunk;
+	//bumped for every loop so sleeping workers know there is work
+	unsigned int round;
+	//workers still on the current loop; the next loop waits for none
+	int active;
+	bool quit;
+
+	ThreadPool() : n(0), grain(1), chunks(0), next_chunk(0), round(0), active(0), quit(false) {}
+
+	~ThreadPool()
+	{
+		stop();
+	}
+
+	/* threads counts the calling thread, so 1 runs everything inline */
+	void start(int threads)
+	{
+		stop();
+		quit=false;
+		unsigned int r=round;
+		for(int i=1;i<threads;i++)
+			workers.push_back(std::thread([this,r]{ work(r); }));
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m);
+			quit=true;
+		}
+		wake.notify_all();
+		for(size_t i=0;i<workers.size();i++)
+			workers[i].join();
+		workers.clear();
+	}
+
+	int threads() const
+	{
+		return workers.size()+1;
+	}
+
+	/* Number of chunks parallel_for(n,grain,...) will use */
+	static int chunks_for(int n,int grain)
+	{
+		return (n+grain-1)/grain;
+	}
+
+	/* Call f(chunk,begin,end) for every chunk of [0,n) */
+	template<class F> void parallel_for(int n,int grain,F f)
+	{
+		int c=chunks_for(n,grain);
+		if(c<=1 || workers.empty()){
+			for(int k=0;k<c;k++)
+				f(k,k*grain,std::min(n,(k+1)*grain));
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m);
+			body=f;
+			this->n=n;
+			this->grain=grain;
+			chunks=c;
+			next_chunk=0;
+			active=workers.size();
+			round++;
+		}
+		wake.notify_all();
+		run_chunks();
+		std::unique_lock<std::mutex> lock(m);
+		finished.wait(lock,[&]{ return active==0; });
+	}
+
+private:
+	void run_chunks()
+	{
+		int k;
+		while((k=next_chunk++)<chunks)
+			body(k,k*grain,std::min(n,(k+1)*grain));
+	}
+
+	void work(unsigned int seen)
+	{
+		for(;;){
+			{
+				std::unique_lock<std::mutex> lock(m);
+				wake.wait(lock,[&]{ return quit || round!=seen; });
+				if(quit)
+					return;
+				seen=round;
+			}
+			run_chunks();
+			std::lock_guard<std::mutex> lock(m);
+			if(--active==0)
+				finished.notify_all();
+		}
+	}
+};
+
+#endif
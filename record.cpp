@@ -0,0 +1,277 @@
+#include <cstring>
+#include <stdint.h>
+
+#include "record.h"
+#include "world.h"
+
+using namespace std;
+
+#define RECORD_VERSION 3
+
+void apply_event(World &world,const InputEvent &ev)
+{
+	switch(ev.type){
+		case EV_KEY:
+			world.key(ev.code,ev.action,ev.mods);
+			break;
+		case EV_CHAR:
+			world.keychar(ev.code);
+			break;
+		case EV_MOUSE_BUTTON:
+			world.mouse_button(ev.code,ev.action,ev.mods);
+			break;
+		case EV_CURSOR:
+			world.cursor(ev.x,ev.y);
+			break;
+		case EV_SCROLL:
+			world.scroll(ev.x,ev.y);
+			break;
+		default:
+			break;
+	}
+}
+
+static void put(FILE *f,uint64_t v,int bytes)
+{
+	unsigned char buf[8];
+	for(int i=0;i<bytes;i++)
+		buf[i]=(v>>(8*i))&0xff;
+	fwrite(buf,1,bytes,f);
+}
+
+static int get(FILE *f,uint64_t &v,int bytes)
+{
+	unsigned char buf[8];
+	if(fread(buf,1,bytes,f)!=(size_t)bytes)
+		return 0;
+	v=0;
+	for(int i=0;i<bytes;i++)
+		v|=(uint64_t)buf[i]<<(8*i);
+	return 1;
+}
+
+static void put_double(FILE *f,double d)
+{
+	uint64_t v;
+	memcpy(&v,&d,8);
+	put(f,v,8);
+}
+
+static int get_double(FILE *f,double &d)
+{
+	uint64_t v;
+	if(!get(f,v,8))
+		return 0;
+	memcpy(&d,&v,8);
+	return 1;
+}
+
+/* 64 bit FNV-1a */
+static uint64_t fnv(uint64_t h,const void *p,size_t n)
+{
+	const unsigned char *c=(const unsigned char *)p;
+	for(size_t i=0;i<n;i++){
+		h^=c[i];
+		h*=0x100000001b3ull;
+	}
+	return h;
+}
+
+/* Hash a file's bytes, or its absence when path is NULL */
+static int hash_file(const char *path,uint64_t &h)
+{
+	if(!path){
+		h=fnv(h,"-",1);
+		return 1;
+	}
+	FILE *f=fopen(path,"rb");
+	if(!f){
+		fprintf(stderr,"Error: cannot read %s\n",path);
+		return 0;
+	}
+	char buf[4096];
+	size_t n;
+	while((n=fread(buf,1,sizeof(buf),f))>0)
+		h=fnv(h,buf,n);
+	fclose(f);
+	//keeps a file's end apart from the next one's start
+	h=fnv(h,"|",1);
+	return 1;
+}
+
+int record_setup(const World &world,const char *mirror_path,const char *level_path,RecordSetup &setup)
+{
+	setup.event_driven=world.event_driven;
+	setup.broadphase=world.broadphase;
+	uint64_t h=0xcbf29ce484222325ull;
+	int32_t settings[4]={world.endless,world.spawn_count,world.spawn_colours,world.fire_count};
+	float rates[3]={world.brick_speed,world.spawn_interval,world.fire_interval};
+	h=fnv(h,settings,sizeof(settings));
+	h=fnv(h,rates,sizeof(rates));
+	if(!hash_file(mirror_path,h) || !hash_file(level_path,h))
+		return 0;
+	setup.hash=h;
+	return 1;
+}
+
+int Recorder::open(const char *path,int tick_rate,uint64_t seed,const RecordSetup &setup)
+{
+	f=fopen(path,"wb");
+	if(!f){
+		fprintf(stderr,"Error: cannot write %s\n",path);
+		return 0;
+	}
+	fwrite("SGRP",1,4,f);
+	put(f,RECORD_VERSION,4);
+	put(f,tick_rate,4);
+	put(f,seed,8);
+	put(f,setup.event_driven,1);
+	put(f,setup.broadphase,1);
+	put(f,setup.hash,8);
+	return 1;
+}
+
+void Recorder::write(const InputEvent &ev)
+{
+	if(!f)
+		return;
+	put(f,ev.tick,4);
+	put(f,ev.type,1);
+	switch(ev.type){
+		case EV_KEY:
+			put(f,(uint16_t)ev.code,2);
+			put(f,ev.action,1);
+			put(f,ev.mods,1);
+			break;
+		case EV_CHAR:
+			put(f,(uint32_t)ev.code,4);
+			break;
+		case EV_MOUSE_BUTTON:
+			put(f,ev.code,1);
+			put(f,ev.action,1);
+			put(f,ev.mods,1);
+			break;
+		case EV_CURSOR:
+		case EV_SCROLL:
+			put_double(f,ev.x);
+			put_double(f,ev.y);
+			break;
+		default:
+			break;
+	}
+}
+
+void Recorder::close(unsigned int end_tick)
+{
+	if(!f)
+		return;
+	InputEvent ev;
+	memset(&ev,0,sizeof(ev));
+	ev.tick=end_tick;
+	ev.type=EV_END;
+	write(ev);
+	fclose(f);
+	f=NULL;
+}
+
+int Replay::open(const char *path)
+{
+	char magic[4];
+	uint64_t version,rate,events,broadphase;
+	f=fopen(path,"rb");
+	if(!f){
+		fprintf(stderr,"Error: cannot read %s\n",path);
+		return 0;
+	}
+	if(fread(magic,1,4,f)!=4 || memcmp(magic,"SGRP",4) || !get(f,version,4)){
+		fprintf(stderr,"Error: %s is not a recording\n",path);
+		close();
+		return 0;
+	}
+	if(version!=RECORD_VERSION){
+		fprintf(stderr,"Error: %s is a version %d recording, this build reads version %d\n",path,(int)version,RECORD_VERSION);
+		close();
+		return 0;
+	}
+	if(!get(f,rate,4) || !get(f,seed,8) || !get(f,events,1) || !get(f,broadphase,1) || !get(f,setup.hash,8)){
+		fprintf(stderr,"Error: %s is not a recording\n",path);
+		close();
+		return 0;
+	}
+	tick_rate=rate;
+	setup.event_driven=events;
+	setup.broadphase=broadphase;
+	return 1;
+}
+
+int Replay::matches(const RecordSetup &now) const
+{
+	const char *name[]={"brute","lanes","grid"};
+	if(now.event_driven!=setup.event_driven){
+		fprintf(stderr,"Error: recording was made %s --events\n",setup.event_driven ? "with" : "without");
+		return 0;
+	}
+	if(now.broadphase!=setup.broadphase){
+		if(setup.broadphase>=BROADPHASE_BRUTE && setup.broadphase<=BROADPHASE_GRID)
+			fprintf(stderr,"Error: recording was made with --broadphase %s\n",name[setup.broadphase]);
+		else
+			fprintf(stderr,"Error: recording was made with an unknown broadphase\n");
+		return 0;
+	}
+	if(now.hash!=setup.hash){
+		fprintf(stderr,"Error: recording was made with other --level, --mirrors or spawn and fire settings\n");
+		return 0;
+	}
+	return 1;
+}
+
+int Replay::next(InputEvent &ev)
+{
+	uint64_t v,a,b,c;
+	if(!f)
+		return 0;
+	memset(&ev,0,sizeof(ev));
+	if(!get(f,v,4) || !get(f,a,1))
+		return 0;
+	ev.tick=v;
+	ev.type=a;
+	switch(ev.type){
+		case EV_KEY:
+			if(!get(f,a,2) || !get(f,b,1) || !get(f,c,1))
+				return 0;
+			ev.code=(int16_t)a;
+			ev.action=b;
+			ev.mods=c;
+			break;
+		case EV_CHAR:
+			if(!get(f,a,4))
+				return 0;
+			ev.code=a;
+			break;
+		case EV_MOUSE_BUTTON:
+			if(!get(f,a,1) || !get(f,b,1) || !get(f,c,1))
+				return 0;
+			ev.code=a;
+			ev.action=b;
+			ev.mods=c;
+			break;
+		case EV_CURSOR:
+		case EV_SCROLL:
+			if(!get_double(f,ev.x) || !get_double(f,ev.y))
+				return 0;
+			break;
+		case EV_END:
+			break;
+		default:
+			fprintf(stderr,"Error: bad event type %d in recording\n",ev.type);
+			return 0;
+	}
+	return 1;
+}
+
+void Replay::close()
+{
+	if(f)
+		fclose(f);
+	f=NULL;
+}
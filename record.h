@@ -0,0 +1,75 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <cstdio>
+#include <stdint.h>
+
+struct World;
+
+/* Input events as the window callbacks see them, stamped with the number
+   of simulation ticks completed before the event arrived */
+enum {
+	EV_KEY=1,
+	EV_CHAR,
+	EV_MOUSE_BUTTON,
+	EV_CURSOR,
+	EV_SCROLL,
+	EV_END
+};
+
+struct InputEvent {
+	unsigned int tick;
+	int type;
+	//key/char/button code, action, mods
+	int code,action,mods;
+	//cursor position in world coordinates or scroll offsets
+	double x,y;
+};
+
+/* Hand an event to the simulation */
+void apply_event(World &world,const InputEvent &ev);
+
+/* What a game depends on besides its seed, tick rate and inputs: the
+   simulation and broadphase it ran with, and a hash of the rest of its
+   setup (spawn and fire settings and the contents of the mirror and level
+   files), so a replay can refuse to run a recording under another one */
+struct RecordSetup {
+	int event_driven;
+	int broadphase;
+	uint64_t hash;
+};
+
+/* Setup of a freshly set up world, played with the given mirror and level
+   files (NULL for none); 0 if either cannot be read */
+int record_setup(const World &world,const char *mirror_path,const char *level_path,RecordSetup &setup);
+
+/* Writes events to a compact little-endian binary file:
+   header "SGRP", version, tick rate, seed, event-driven and broadphase
+   bytes, setup hash; then per event the tick, the type byte and only the
+   fields that type uses. EV_END carries the last tick. */
+struct Recorder {
+	FILE *f;
+
+	Recorder() : f(NULL) {}
+	int open(const char *path,int tick_rate,uint64_t seed,const RecordSetup &setup);
+	void write(const InputEvent &ev);
+	void close(unsigned int end_tick);
+};
+
+struct Replay {
+	FILE *f;
+	int tick_rate;
+	uint64_t seed;
+	RecordSetup setup;
+
+	Replay() : f(NULL), tick_rate(0), seed(0) {}
+	int open(const char *path);
+	/* Whether the world was set up like the recorded one; says what
+	   differs if not */
+	int matches(const RecordSetup &now) const;
+	//returns 0 at end of file; the final event returned is EV_END
+	int next(InputEvent &ev);
+	void close();
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* xoshiro256** generator. Each World owns one so runs with the same seed
+   produce the same bricks and worlds on different threads never share
+   state. */
+struct Rng {
+	uint64_t s[4];
+
+	static uint64_t rotl(uint64_t x,int k)
+	{
+		return (x<<k)|(x>>(64-k));
+	}
+
+	/* Expand the seed with splitmix64 so nearby seeds give unrelated streams */
+	void seed(uint64_t seed)
+	{
+		for(int i=0;i<4;i++){
+			uint64_t z=(seed+=0x9e3779b97f4a7c15ULL);
+			z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+			z=(z^(z>>27))*0x94d049bb133111ebULL;
+			s[i]=z^(z>>31);
+		}
+	}
+
+	uint64_t next()
+	{
+		uint64_t result=rotl(s[1]*5,7)*9;
+		uint64_t t=s[1]<<17;
+		s[2]^=s[0];
+		s[3]^=s[1];
+		s[1]^=s[2];
+		s[0]^=s[3];
+		s[2]^=t;
+		s[3]=rotl(s[3],45);
+		return result;
+	}
+
+	/* Uniform integer in [0,n) from a single draw: the high 64 bits of a
+	   64x64 bit product. No modulo and no retry loop; the bias is at most
+	   n/2^64. */
+	uint32_t bounded(uint32_t n)
+	{
+		return (uint32_t)(((unsigned __int128)next()*n)>>64);
+	}
+
+	/* Uniform float in [0,1) */
+	float uniform()
+	{
+		return (next()>>40)*(1.0f/16777216.0f);
+	}
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "snapshot.h"
+
+using namespace std;
+
+void take_snapshot(World &world,float alpha,Snapshot &s)
+{
+	s.tick=world.tick;
+	s.alpha=alpha;
+	for(int i=PLAYER_CANON;i<=PLAYER_GREEN;i++){
+		s.player[i]=world.players.xf(i);
+		s.player_prev[i]=world.players.prev(i);
+	}
+
+	BrickPool &brick=world.brick;
+	s.brick_x.assign(brick.x.begin(),brick.x.begin()+brick.count);
+	s.brick_prev.assign(brick.prev.begin(),brick.prev.begin()+brick.count);
+	s.brick_trans.assign(brick.trans.begin(),brick.trans.begin()+brick.count);
+	s.brick_color.assign(brick.color.begin(),brick.color.begin()+brick.count);
+
+	s.bullet.resize(world.bullet.count);
+	for(int i=0;i<world.bullet.count;i++){
+		const bulletshape &b=world.bullet.b[i];
+		bulletview &v=s.bullet[i];
+		v.prevx=b.prevx;
+		v.prevy=b.prevy;
+		v.newx=b.newx;
+		v.newy=b.newy;
+		v.dirx=b.dirx;
+		v.diry=b.diry;
+	}
+
+	s.mirror_xf.clear();
+	s.mirror_mesh.clear();
+	world.mirrors.each(COMP_TRANSFORM|COMP_MESH,[&](Archetype &a){
+		s.mirror_xf.insert(s.mirror_xf.end(),a.xf.begin(),a.xf.end());
+		s.mirror_mesh.insert(s.mirror_mesh.end(),a.mesh.begin(),a.mesh.end());
+	});
+
+	s.wrong=world.wrong;
+	s.zoom=world.zoom;
+	s.pan=world.pan;
+
+	s.aim=-1;
+	if(world.aiming()){
+		const xform &canon=world.players.xf(PLAYER_CANON),&prev=world.players.prev(PLAYER_CANON);
+		float angle=prev.rot+(canon.rot-prev.rot)*alpha;
+		float height=prev.y+(canon.y-prev.y)*alpha;
+		s.aim=world.aimpreview(angle,height);
+		s.aim_version=world.aim.version;
+		s.aim_path=world.aim.paths[s.aim];
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+
+#include "world.h"
+
+/* What the renderer reads of the world at the end of a frame's ticks,
+   copied out so it can be drawn while the simulation moves on.
+
+   sample2D keeps two: each frame the simulation runs the next ticks and
+   fills one while the renderer draws the one filled the frame before, and
+   the two swap once both are done. Nothing writes a snapshot while it is
+   being drawn, so neither side takes a lock. */
+
+typedef struct bulletview{
+	float prevx,prevy;
+	float newx,newy;
+	float dirx,diry;
+}bulletview;
+
+struct Snapshot {
+	unsigned int tick;
+	//how far between the last two ticks to draw
+	float alpha;
+	//canon and baskets by PLAYER_* id, now and at the start of the tick
+	xform player[3],player_prev[3];
+	std::vector<float> brick_x,brick_prev,brick_trans;
+	std::vector<int> brick_color;
+	std::vector<bulletview> bullet;
+	std::vector<xform> mirror_xf;
+	std::vector<int> mirror_mesh;
+	int wrong;
+	int zoom;
+	float pan;
+	//aim preview: its index in world.aim.paths as of aim_version, and a
+	//copy of the path; aim is -1 when the canon is not being aimed
+	int aim;
+	unsigned int aim_version;
+	aimpath aim_path;
+};
+
+/* Fill s from the world; alpha is how far into the next tick the frame
+   is. Reuses the vectors' storage, so a steady game does not allocate. */
+void take_snapshot(World &world,float alpha,Snapshot &s);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <stdint.h>
+#include <vector>
+
+/* Hierarchical timer wheel counted in simulation ticks.
+
+   Level 0 has a slot for each of the next 64 ticks. Each higher level
+   has 64 slots that are 64 times as wide as the slots of the level below.
+   A timer goes in the lowest level whose span covers its due tick. When
+   the low bits of the current tick wrap, the matching slot of the level
+   above is emptied back into the wheel. Adding a timer and advancing one
+   tick are O(1) however many timers are waiting, and a timer always
+   fires on its exact tick, even when many ticks are run back to back. */
+
+#define TIMER_BITS 6
+#define TIMER_SLOTS (1<<TIMER_BITS)
+#define TIMER_LEVELS 4
+
+typedef struct timer{
+	uint64_t due;
+	int kind;
+	//next timer in the same slot, -1 at the end
+	int next;
+}timer;
+
+struct TimerWheel {
+	//last tick that has been run
+	uint64_t now;
+	std::vector<timer> t;
+	std::vector<int> free_ids;
+	//slots are FIFO lists so timers due on the same tick fire in the order
+	//they were added
+	int head[TIMER_LEVELS][TIMER_SLOTS];
+	int tail[TIMER_LEVELS][TIMER_SLOTS];
+
+	TimerWheel()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		now=0;
+		t.clear();
+		free_ids.clear();
+		for(int l=0;l<TIMER_LEVELS;l++)
+			for(int s=0;s<TIMER_SLOTS;s++)
+				head[l][s]=tail[l][s]=-1;
+	}
+
+	/* Run kind on tick due; a due tick that has already been run means
+	   the next tick */
+	void add(uint64_t due,int kind)
+	{
+		int id;
+		if(free_ids.empty()){
+			id=t.size();
+			t.push_back(timer());
+		}
+		else{
+			id=free_ids.back();
+			free_ids.pop_back();
+		}
+		t[id].due=due>now ? due : now+1;
+		t[id].kind=kind;
+		place(id);
+	}
+
+	/* Run every tick up to and including to, calling f(kind) for each
+	   timer as it comes due. f may add timers. */
+	template<class F> void advance(uint64_t to,F f)
+	{
+		while(now<to){
+			now++;
+			//empty the higher slots that start at this tick, top down so a
+			//timer can fall more than one level
+			int top=0;
+			while(top+1<TIMER_LEVELS && !(now&(((uint64_t)1<<(TIMER_BITS*(top+1)))-1)))
+				top++;
+			for(int l=top;l>0;l--)
+				cascade(l,(now>>(TIMER_BITS*l))&(TIMER_SLOTS-1));
+			int s=now&(TIMER_SLOTS-1);
+			int id=head[0][s];
+			head[0][s]=tail[0][s]=-1;
+			while(id>=0){
+				int next=t[id].next,kind=t[id].kind;
+				free_ids.push_back(id);
+				f(kind);
+				id=next;
+			}
+		}
+	}
+
+	void place(int id)
+	{
+		uint64_t diff=t[id].due^now;
+		int l=0;
+		while(l+1<TIMER_LEVELS && diff>>(TIMER_BITS*(l+1)))
+			l++;
+		//timers beyond the top level wait in its slots and are placed
+		//again each time their slot comes round
+		int s=(t[id].due>>(TIMER_BITS*l))&(TIMER_SLOTS-1);
+		t[id].next=-1;
+		if(tail[l][s]>=0)
+			t[tail[l][s]].next=id;
+		else
+			head[l][s]=id;
+		tail[l][s]=id;
+	}
+
+	void cascade(int l,int s)
+	{
+		int id=head[l][s];
+		head[l][s]=tail[l][s]=-1;
+		while(id>=0){
+			int next=t[id].next;
+			place(id);
+			id=next;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,1107 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "world.h"
+#include "kernels.h"
+#include "level.h"
+
+using namespace std;
+
+/* Place the segment of a mirror centred on its transform */
+static void setmirror(collider &m,const xform &t)
+{
+	//x1,y1 is always the left end of the mirror
+	float c=0.6*cos(t.rot*M_PI/180.0f),s=0.6*sin(t.rot*M_PI/180.0f);
+	if(c<0)
+		c=-c,s=-s;
+	m.x1=-c+t.x;
+	m.y1=-s+t.y;
+	m.x2=c+t.x;
+	m.y2=s+t.y;
+	m.normx=-s/0.6f;
+	m.normy=c/0.6f;
+}
+
+static inline bvhbox mirror_box(const collider &m)
+{
+	bvhbox b={fmin(m.x1,m.x2),fmin(m.y1,m.y2),fmax(m.x1,m.x2),fmax(m.y1,m.y2)};
+	return b;
+}
+
+/* Mirrors are added one at a time; call buildmirrors() once done. Moving
+   mirrors get a velocity, so they sit in their own archetype. */
+void World::addmirror(float x,float y,float rot,float vx,float vy,float spin)
+{
+	int moves=vx!=0 || vy!=0 || spin!=0;
+	uint32_t e=mirrors.create(COMP_TRANSFORM|COMP_COLLIDER|COMP_MESH|(moves ? COMP_VELOCITY : 0));
+	Archetype &a=mirrors.arch[mirrors.arch_of[e]];
+	int r=mirrors.row_of[e];
+	xform t={x,y,rot};
+	a.xf[r]=t;
+	setmirror(a.col[r],t);
+	a.mesh[r]=MESH_MIRROR;
+	if(moves){
+		velocity v={vx,vy,spin};
+		a.vel[r]=v;
+	}
+}
+
+/* Call after adding or removing mirrors; the paths of bullets in flight
+   are traced again from where they are */
+void World::buildmirrors()
+{
+	std::vector<bvhbox> boxes(mirrors.size());
+	memset(lane_blockers,0,sizeof(lane_blockers));
+	for(int j=0;j<mirrors.size();j++){
+		collider &m=mirrors.col(j);
+		boxes[j]=mirror_box(m);
+		m.lanes=mirror_lanes(m);
+		for(int i=0;i<SPAWN_LANES;i++)
+			lane_blockers[i]+=m.lanes>>i&1;
+	}
+	mirror_bvh.build(boxes);
+	aim.clear();
+	setlanes();
+	for(int j=0;j<bullet.count;j++)
+		retrace(j,time);
+	if(event_driven && bullet.count)
+		replan(time);
+}
+
+/* Spawn lanes mirror m lies across; bricks may not fall on mirrors */
+int World::mirror_lanes(const collider &m) const
+{
+	int lanes=0;
+	for(int i=0;i<SPAWN_LANES;i++)
+		if(crossing(m,SPAWN_MIN+i,5,SPAWN_MIN+i,-5)>=0)
+			lanes|=1<<i;
+	return lanes;
+}
+
+/* List the spawn lanes no mirror lies across */
+void World::setlanes()
+{
+	spawn_lanes.clear();
+	for(int i=0;i<SPAWN_LANES;i++)
+		if(!lane_blockers[i])
+			spawn_lanes.push_back(SPAWN_MIN+i);
+}
+
+/* Trace the path of bullet j again from where it is at time now */
+void World::retrace(int j,double now)
+{
+	bulletshape &b=bullet.b[j];
+	float r=event_driven ? BULLET_SPEED*(now-b.t0) : b.rad;
+	tracepath(b,b.nx+r*b.dirx,b.ny+r*b.diry,b.dirx,b.diry,b.path[b.seg].s+r,b.last_mirror);
+	b.t0=now;
+}
+
+/* Whether segment a->b passes through any of the boxes swept this tick */
+int World::crosses_swept(float ax,float ay,float bx,float by) const
+{
+	float best;
+	return swept_bvh.raycast(ax,ay,bx,by,[](int){ return 0.0f; },best)>=0;
+}
+
+/* Whether the rest of bullet b's path from time now crosses a box swept
+   this tick */
+int World::path_crosses(const bulletshape &b,double now) const
+{
+	float r=event_driven ? BULLET_SPEED*(now-b.t0) : b.rad;
+	float ax=b.nx+r*b.dirx,ay=b.ny+r*b.diry;
+	for(int k=b.seg;k<b.segs;k++){
+		const pathseg &p=b.path[k];
+		float bx,by;
+		if(k+1<b.segs){
+			bx=b.path[k+1].x;
+			by=b.path[k+1].y;
+		}
+		else{
+			//the last stretch runs out of the field or to end_mirror
+			bx=p.x+(b.path_end-p.s)*p.dirx;
+			by=p.y+(b.path_end-p.s)*p.diry;
+		}
+		if(crosses_swept(ax,ay,bx,by))
+			return 1;
+		ax=bx;
+		ay=by;
+	}
+	return 0;
+}
+
+/* Slide and spin the moving mirrors by dt. Only the archetypes with a
+   velocity are visited: their BVH leaves are refitted, the spawn lanes
+   change only if one crosses a lane, and only bullets and aim previews
+   whose paths pass where one of those mirrors was or is get traced
+   again. */
+void World::movemirrors(float dt,double now)
+{
+	int lanes_changed=0;
+	swept.clear();
+	mirrors.each(COMP_TRANSFORM|COMP_VELOCITY|COMP_COLLIDER,[&](Archetype &a){
+		for(int r=0;r<a.count;r++){
+			xform &t=a.xf[r];
+			velocity &v=a.vel[r];
+			collider &m=a.col[r];
+			bvhbox old=mirror_box(m);
+			t.x+=v.vx*dt;
+			t.y+=v.vy*dt;
+			if(fabs(t.x)>MIRROR_RANGE){
+				v.vx=-v.vx;
+				t.x=t.x>0 ? MIRROR_RANGE : -MIRROR_RANGE;
+			}
+			if(fabs(t.y)>MIRROR_RANGE){
+				v.vy=-v.vy;
+				t.y=t.y>0 ? MIRROR_RANGE : -MIRROR_RANGE;
+			}
+			t.rot=fmod(t.rot+v.spin*dt,360.0f);
+			setmirror(m,t);
+			bvhbox now_box=mirror_box(m);
+			mirror_bvh.update(a.entity[r],now_box);
+			//with room for a bullet's tip
+			bvhbox c={fmin(old.x0,now_box.x0)-0.1f,fmin(old.y0,now_box.y0)-0.1f,fmax(old.x1,now_box.x1)+0.1f,fmax(old.y1,now_box.y1)+0.1f};
+			swept.push_back(c);
+			int lanes=mirror_lanes(m);
+			if(lanes!=m.lanes){
+				for(int i=0;i<SPAWN_LANES;i++)
+					lane_blockers[i]+=(lanes>>i&1)-(m.lanes>>i&1);
+				m.lanes=lanes;
+				lanes_changed=1;
+			}
+		}
+	});
+	if(swept.empty())
+		return;
+	if(lanes_changed)
+		setlanes();
+	swept_bvh.build(swept);
+	for(int p=0;p<(int)aim.paths.size();p++){
+		if(aim.cell_of[p]<0)
+			continue;
+		const aimpath &a=aim.paths[p];
+		for(int k=0;k+1<a.n;k++)
+			if(crosses_swept(a.x[k],a.y[k],a.x[k+1],a.y[k+1])){
+				aim.drop(p);
+				break;
+			}
+	}
+	for(int j=0;j<bullet.count;j++){
+		if(!path_crosses(bullet.b[j],now))
+			continue;
+		retrace(j,now);
+		if(event_driven)
+			plan_bullet(j,now);
+	}
+}
+
+/* Replace the mirrors with those in a text file, one "x y angle" per
+   line, followed by "vx vy spin" for a moving mirror; blank lines and
+   lines starting with # are skipped */
+int World::load_mirrors(const char *path)
+{
+	FILE *f=fopen(path,"r");
+	if(!f){
+		fprintf(stderr,"Error: cannot read %s\n",path);
+		return 0;
+	}
+	mirrors.clear();
+	char line[256];
+	int n=0;
+	while(fgets(line,sizeof(line),f)){
+		float x,y,rot,vx=0,vy=0,spin=0;
+		n++;
+		char *p=line;
+		while(*p==' ' || *p=='\t')
+			p++;
+		if(*p=='#' || *p=='\n' || *p=='\r' || !*p)
+			continue;
+		int got=sscanf(p,"%f %f %f %f %f %f",&x,&y,&rot,&vx,&vy,&spin);
+		if(got!=3 && got!=6){
+			fprintf(stderr,"Error: %s:%d: expected x y angle [vx vy spin]\n",path,n);
+			fclose(f);
+			return 0;
+		}
+		addmirror(x,y,rot,vx,vy,spin);
+	}
+	fclose(f);
+	buildmirrors();
+	return 1;
+}
+
+/* The first mirror other than skip that the segment a->b crosses, or -1;
+   t is the fraction along the segment */
+int World::firstmirror(float ax,float ay,float bx,float by,int skip,float &t) const
+{
+	return mirror_bvh.raycast(ax,ay,bx,by,[&](int j){
+		if(j==skip)
+			return -1.0f;
+		return crossing(mirrors.col(j),ax,ay,bx,by);
+	},t);
+}
+
+void World::init(uint64_t seed)
+{
+	//value-initialising zeroes every plain member
+	*this=World();
+	this->seed=seed;
+	rng.seed(seed);
+	addmirror(-1.5,3.5,120);
+	addmirror(3.5,3.0,120);
+	addmirror(1,-2.5,25);
+	buildmirrors();
+	players.create(COMP_TRANSFORM|COMP_VELOCITY|COMP_PREV|COMP_MESH);
+	players.mesh(PLAYER_CANON)=MESH_CANON;
+	for(int c=1;c<=2;c++){
+		uint32_t e=players.create(COMP_TRANSFORM|COMP_VELOCITY|COMP_PREV|COMP_MESH|COMP_COLOUR);
+		players.mesh(e)=c==1 ? MESH_RED_BASKET : MESH_GREEN_BASKET;
+		players.colour(e)=c;
+	}
+	players.create(COMP_TRANSFORM|COMP_VELOCITY|COMP_PREV);
+	brick_speed=BRICK_SPEED;
+	broadphase=BROADPHASE_LANES;
+	spawn_interval=2.0;
+	spawn_count=1;
+	spawn_colours=7;
+	fire_interval=1.0;
+	fire_count=1;
+	mouse_ready=1;
+	tick_dt=1.0f/TICK_RATE;
+}
+
+/* Executed when a regular key is pressed/released/held-down */
+void World::key(int key,int action,int mods)
+{
+	if (action == ACTION_RELEASE) {
+		if(key==KEY_RIGHT )
+		{
+			rightkey=0;
+			players.vel(PLAYER_RED).vx=0;
+			players.vel(PLAYER_GREEN).vx=0;
+		}
+		if(key==KEY_LEFT)
+		{
+			leftkey=0;
+			players.vel(PLAYER_RED).vx=0;
+			players.vel(PLAYER_GREEN).vx=0;
+		}
+		if(key==KEY_RIGHT_CONTROL)
+		{
+			rightctrl=0;
+			players.vel(PLAYER_RED).vx=0;
+		}
+		if(key==KEY_RIGHT_ALT)
+		{
+			rightalt=0;
+			players.vel(PLAYER_GREEN).vx=0;
+		}
+		switch (key) {
+			case KEY_A:
+				players.vel(PLAYER_CANON).spin=0;
+				break;
+			case KEY_D:
+				players.vel(PLAYER_CANON).spin=0;
+				break;
+			case KEY_S:
+				players.vel(PLAYER_CANON).vy=0;
+				break;
+			case KEY_F:
+				players.vel(PLAYER_CANON).vy=0;
+				break;
+			case KEY_SPACE:
+				spaceflag=0;
+				break;
+			default:
+				break;
+		}
+	}
+	else if (action == ACTION_PRESS) {
+		if(key==KEY_RIGHT)
+			rightkey=1;
+		if(key==KEY_LEFT)
+		{
+			leftkey=1;
+		}
+		if(key==KEY_RIGHT_CONTROL)
+		{
+			rightctrl=1;
+		}
+		if(key==KEY_RIGHT_ALT)
+		{
+			rightalt=1;
+		}
+		if(rightctrl==1 && rightkey==1)
+		{
+			players.vel(PLAYER_RED).vx=MOVE_SPEED;
+		}
+		if(rightctrl==1 && leftkey==1)
+		{
+			players.vel(PLAYER_RED).vx=-MOVE_SPEED;
+		}
+		if(rightkey==1 && rightalt==1)
+		{
+			players.vel(PLAYER_GREEN).vx=MOVE_SPEED;
+		}
+		if(leftkey==1 && rightalt==1)
+		{
+			players.vel(PLAYER_GREEN).vx=-MOVE_SPEED;
+		}
+		if(key==KEY_UP && zoom<4)
+			zoom++;
+		if(key==KEY_DOWN && zoom)
+			zoom--;
+		if(key==KEY_LEFT && zoom)
+			pan++;
+		if(key==KEY_RIGHT && zoom)
+			pan--;
+		clamp_pan();
+		switch (key) {
+			case KEY_ESCAPE:
+				gameover=3;
+				break;
+			case KEY_A:
+				players.vel(PLAYER_CANON).spin=CANON_ROT_SPEED;
+				break;
+			case KEY_D:
+				players.vel(PLAYER_CANON).spin=-CANON_ROT_SPEED;
+				break;
+			case KEY_S:
+				players.vel(PLAYER_CANON).vy=MOVE_SPEED;
+				break;
+			case KEY_F:
+				players.vel(PLAYER_CANON).vy=-MOVE_SPEED;
+				break;
+			case KEY_SPACE:
+				spaceflag=1;
+				break;
+			case KEY_N:
+				brick_speed+=1.2;
+				break;
+			case KEY_M:
+				if(brick_speed-0.6>0.0)
+					brick_speed-=0.6;
+			default:
+				break;
+		}
+	}
+}
+
+/* Executed for character input (like in text boxes) */
+void World::keychar(unsigned int key)
+{
+	switch (key) {
+		case 'Q':
+		case 'q':
+			gameover=3;
+			break;
+		default:
+			break;
+	}
+}
+
+/* Cursor position in world coordinates */
+void World::cursor(double x,double y)
+{
+	mouse_xpos=x;
+	mouse_ypos=y;
+	if(m_redbasket==1 && 1+mouse_xpos<5.5 && 1+mouse_xpos>-1.75)
+		players.xf(PLAYER_RED).x=1+mouse_xpos;
+	if(m_greenbasket && -1+mouse_xpos<3.5 && -1+mouse_xpos>-3.75)
+		players.xf(PLAYER_GREEN).x=-1+mouse_xpos;
+	if(m_canon && mouse_ypos>-3.5 && mouse_ypos<3.5)
+		players.xf(PLAYER_CANON).y=mouse_ypos;
+}
+
+/* Executed when a mouse button is pressed/released */
+void World::mouse_button(int button,int action,int mods)
+{
+	if(action==ACTION_RELEASE){
+		if(button==MOUSE_BUTTON_LEFT){
+			m_redbasket=0;
+			m_greenbasket=0;
+			m_canon=0;
+		}
+		if(button==MOUSE_BUTTON_RIGHT)
+			m_flag=0;
+	}
+	else if(action==ACTION_PRESS){
+		if(button==MOUSE_BUTTON_LEFT){
+			if(mouse_xpos>=-5.0 && mouse_xpos<=-4.65 && mouse_ypos>=players.xf(PLAYER_CANON).y-0.1 && mouse_ypos<=players.xf(PLAYER_CANON).y+0.1){
+				m_canon=1;
+			}
+			else if(mouse_xpos>=-1.35+players.xf(PLAYER_RED).x && mouse_xpos<=-0.65+players.xf(PLAYER_RED).x && mouse_ypos<=-3.9 && mouse_ypos>=-4.9){
+				m_redbasket=1;
+			}
+			else if(mouse_xpos>=0.65+players.xf(PLAYER_GREEN).x && mouse_xpos<=1.35+players.xf(PLAYER_GREEN).x && mouse_ypos<=-3.9 && mouse_ypos>=-4.9)
+				m_greenbasket=1;
+			else if(mouse_xpos>-4.42 && mouse_ready){
+				float slope=(mouse_ypos-players.xf(PLAYER_CANON).y)/(mouse_xpos+4.42);
+				float mouseangle=(atan(slope)*180.0)/M_PI;
+
+				if(mouseangle>=-60 && mouseangle<=60){
+					mouse_ready=0;
+					timers.add(tick+ticks_for(1.0),TIMER_MOUSE);
+					players.xf(PLAYER_CANON).rot=mouseangle;
+					createbullets(mouseangle);
+				}
+
+			}
+		}
+		if(button==MOUSE_BUTTON_RIGHT){
+			if(!m_flag){
+				mouse_click_x=mouse_xpos;
+			}
+			m_flag=1;
+		}
+	}
+}
+
+void World::scroll(double xoffset,double yoffset)
+{
+	zoom += yoffset;
+	if(zoom>=5)
+		zoom=4;
+	if(zoom<0)
+		zoom=0;
+	clamp_pan();
+}
+
+void World::clamp_pan()
+{
+	if(pan>zoom)
+		pan=zoom;
+	if(pan<-zoom)
+		pan=-zoom;
+}
+
+uint32_t World::createbullets(float angle)
+{
+	bulletshape b;
+	b.rad=0;
+	b.dist=0;
+	b.trans=players.xf(PLAYER_CANON).y;
+	b.newx=-4.68;
+	b.newy=b.trans;
+	b.prevx=b.newx;
+	b.prevy=b.newy;
+	b.reflect=0;
+	tracepath(b,b.newx,b.newy,cos(angle*M_PI/180.0f),sin(angle*M_PI/180.0f),0,-1);
+	b.t0=time;
+	b.next=time;
+	b.version=0;
+	b.target=-1;
+	b.plan=0;
+	uint32_t h=bullet.add(b);
+	//the pool is full; the shot is lost
+	if(h==BULLET_NONE)
+		return h;
+	shots++;
+	if(event_driven)
+		plan_bullet(bullet.find(h),time);
+	return h;
+}
+
+void World::createbricks(float x,int color)
+{
+	//color 1:red 2:GREEN 0:black
+	int id=brick.add(x,color);
+	lanes.add(id,x,fallen);
+	if(grid_live){
+		float x0,y0,x1,y1;
+		gridbox(id,x0,y0,x1,y1);
+		grid.insert(id,x0,y0,x1,y1);
+	}
+	if(event_driven)
+		newbrick(brick.count-1);
+}
+
+void World::removebrick(int i)
+{
+	if(grid_live){
+		float x0,y0,x1,y1;
+		gridbox(brick.id[i],x0,y0,x1,y1);
+		grid.remove(brick.id[i],x0,y0,x1,y1);
+	}
+	lanes.remove(brick.id[i]);
+	brick.remove(i);
+}
+
+/* Spawn a brick of random colour in a random lane clear of mirrors;
+   nothing spawns if mirrors block every lane */
+void World::randombricks()
+{
+	if(spawn_lanes.empty())
+		return;
+	int x=spawn_lanes[rng.bounded(spawn_lanes.size())];
+	//the k-th of the allowed colours
+	int k=rng.bounded(__builtin_popcount(spawn_colours)),p=0;
+	for(;;p++)
+		if((spawn_colours>>p&1) && !k--)
+			break;
+	createbricks(x,p);
+}
+
+/* Dense index of the first brick (in pool order) the bullet touches, or
+   -1. All three broadphases pick the same brick. */
+int World::firsthit(const bulletshape &b) const
+{
+	float tip=b.newx+0.09f*b.dirx;
+	int hit=-1;
+	if(broadphase==BROADPHASE_BRUTE){
+		//eight bricks at a time through the SIMD kernel
+		hit=first_touch(brick.x.data(),brick.trans.data(),brick.count,tip,b.newy);
+	}
+	else if(broadphase==BROADPHASE_GRID){
+		float y=b.newy+fallen;
+		grid.query(tip,y,tip,y,[&](int id){
+			int i=brick.index[id];
+			if(i>=0 && (hit<0 || i<hit) && touches(brick.x[i],brick.trans[i],tip,b.newy))
+				hit=i;
+		});
+	}
+	else{
+		//touching needs fallen-key within [4.55-y,4.95-y]; keys are
+		//widened a little as brick.trans is accumulated in float
+		double k0=fallen-4.95+b.newy-1e-3,k1=fallen-4.55+b.newy+1e-3;
+		lanes.query(tip-0.1,tip+0.1,k0,k1,[&](int id){
+			int i=brick.index[id];
+			if((hit<0 || i<hit) && touches(brick.x[i],brick.trans[i],tip,b.newy))
+				hit=i;
+		});
+	}
+	return hit;
+}
+
+/* Each bullet in turn hits the first brick it touches, so a brick shot by
+   one bullet is gone for the next. The lookups run in parallel against
+   the bricks as they were at the start; the serial pass then brings each
+   answer up to date with the bricks shot since, which only needs a fresh
+   lookup when the bullet's own brick was the one shot. */
+void World::checkcollision()
+{
+	static ThreadPool serial;
+	ThreadPool &p=pool ? *pool : serial;
+	hit.resize(bullet.count);
+	shots_this_tick.clear();
+	p.parallel_for(bullet.count,BULLET_GRAIN,[&](int,int begin,int end){
+		for(int j=begin;j<end;j++)
+			hit[j]=firsthit(bullet.b[j]);
+	});
+	for(int j=0;j<bullet.count;)
+	{
+		const bulletshape &b=bullet.b[j];
+		float tip=b.newx+0.09f*b.dirx;
+		int h=hit[j];
+		for(size_t k=0;k<shots_this_tick.size();k++){
+			const shot &r=shots_this_tick[k];
+			if(h==r.i){
+				h=firsthit(b);
+				break;
+			}
+			//the last brick moved down into the shot brick's place
+			if(h==r.last || (r.i<h && touches(r.x,r.trans,tip,b.newy)))
+				h=r.i;
+		}
+		if(h<0){
+			j++;
+			continue;
+		}
+		shot r={h,brick.count-1,brick.x[brick.count-1],brick.trans[brick.count-1]};
+		shots_this_tick.push_back(r);
+		shootbrick(h);
+		//the last bullet moves into slot j, so look at j again
+		int last=bullet.count-1;
+		hit[j]=hit[last];
+		bullet.remove(j);
+	}
+}
+
+/* Score a bullet hitting the brick at dense index i and remove the brick */
+void World::shootbrick(int i)
+{
+	if(brick.color[i]==0)
+		score+=10;
+	else{
+		wrong++;
+		score-=5;
+		if(wrong>4 && !endless)
+		{
+			if(!quiet){
+				printf("GAME OVER!\n");
+				printf("Score: %d\n",score);
+			}
+			gameover=2;
+		}
+	}
+	removebrick(i);
+	if(!quiet)
+		printf("Score: %d\n",score);
+}
+
+/* Fraction along the segment (ax,ay)-(bx,by) at which it crosses mirror
+   m, or -1 if it does not */
+float crossing(const collider &m,float ax,float ay,float bx,float by)
+{
+	float s1_x, s1_y, s2_x, s2_y, q, p, r;
+
+	s1_x = m.x2 - m.x1;
+	s1_y = m.y2 - m.y1;
+	s2_x = bx - ax;
+	s2_y = by - ay;
+
+	r=s1_x*s2_y - s2_x*s1_y;
+	if(r==0){
+		return -1;
+	}
+
+	p = (s1_x*(m.y1-ay) - s1_y*(m.x1-ax))/r;
+	q = (s2_x*(m.y1-ay) - s2_y*(m.x1-ax))/r;
+
+	if (p>=0 && p<=1 && q>=0 && q<=1)
+		return p;
+	return -1;
+}
+
+/* Make the stretch b.path[b.seg] the one the bullet is on */
+static inline void loadseg(bulletshape &b)
+{
+	const pathseg &p=b.path[b.seg];
+	b.nx=p.x;
+	b.ny=p.y;
+	b.dirx=p.dirx;
+	b.diry=p.diry;
+	b.last_mirror=p.mirror;
+	if(p.mirror>=0)
+		b.reflect=1;
+}
+
+/* Fill b.path with the path of a bullet at x,y heading along dirx,diry
+   that has come s along its path so far and is leaving mirror skip. The
+   tip, 0.09 ahead of the centre and 0.01 lower, is swept to the field
+   edge and turned at the first mirror it meets, for up to PATH_SEGS
+   stretches. Each bullet does this when fired instead of testing the
+   mirrors every tick. */
+void World::tracepath(bulletshape &b,float x,float y,float dirx,float diry,float s,int skip) const
+{
+	b.segs=0;
+	b.seg=0;
+	for(;;){
+		pathseg &p=b.path[b.segs++];
+		p.x=x;
+		p.y=y;
+		p.dirx=dirx;
+		p.diry=diry;
+		p.s=s;
+		p.mirror=skip;
+		//how far the centre goes before it leaves the field
+		float len=1e30f;
+		if(dirx>0)
+			len=fmin(len,(FIELD_EDGE-x)/dirx);
+		else if(dirx<0)
+			len=fmin(len,(-FIELD_EDGE-x)/dirx);
+		if(diry>0)
+			len=fmin(len,(FIELD_EDGE-y)/diry);
+		else if(diry<0)
+			len=fmin(len,(-FIELD_EDGE-y)/diry);
+		if(len<0)
+			len=0;
+		float ax=x+0.09f*dirx,ay=y+0.09f*diry-0.01f,f;
+		int hit=firstmirror(ax,ay,ax+len*dirx,ay+len*diry,skip,f);
+		if(hit<0){
+			b.path_end=s+len;
+			b.end_mirror=-1;
+			break;
+		}
+		//where the centre is when the tip meets the mirror
+		float d=f*len;
+		x+=d*dirx;
+		y+=d*diry;
+		s+=d;
+		if(b.segs==PATH_SEGS){
+			b.path_end=s;
+			b.end_mirror=hit;
+			break;
+		}
+		//d-2(d.n)n, the same as angle=2*rot-angle; a flat mirror cannot be
+		//hit twice in a row
+		const collider &m=mirrors.col(hit);
+		float dn=2*(dirx*m.normx+diry*m.normy);
+		dirx-=dn*m.normx;
+		diry-=dn*m.normy;
+		skip=hit;
+	}
+	loadseg(b);
+}
+
+/* Distance along the path at which the bullet's current stretch ends,
+   or 1e30 if it runs out of the field */
+float World::segend(const bulletshape &b) const
+{
+	if(b.seg+1<b.segs)
+		return b.path[b.seg+1].s;
+	return b.end_mirror>=0 ? b.path_end : 1e30f;
+}
+
+/* Move the bullet on to the next stretch of its path, tracing more of
+   the path if it has used up the traced part */
+void World::nextseg(bulletshape &b) const
+{
+	if(b.seg+1<b.segs){
+		b.seg++;
+		loadseg(b);
+		return;
+	}
+	const pathseg &p=b.path[b.seg];
+	float d=b.path_end-p.s;
+	const collider &m=mirrors.col(b.end_mirror);
+	float dn=2*(p.dirx*m.normx+p.diry*m.normy);
+	tracepath(b,p.x+d*p.dirx,p.y+d*p.diry,p.dirx-dn*m.normx,p.diry-dn*m.normy,b.path_end,b.end_mirror);
+}
+
+/* Put the bullet at distance dist along its path */
+void World::movebullet(bulletshape &b)
+{
+	//bounded in case a path keeps bouncing without getting anywhere
+	for(int k=0;k<PATH_SEGS && b.dist>=segend(b);k++)
+		nextseg(b);
+	b.rad=b.dist-b.path[b.seg].s;
+	b.newx=b.nx+b.rad*b.dirx;
+	b.newy=b.ny+b.rad*b.diry;
+}
+
+/* Index in aim.paths of the path a bullet fired now at this angle and
+   canon height would take, to the nearest cell of the cache */
+int World::aimpreview(float angle,float height)
+{
+	int c=AimCache::cell(angle,height);
+	if(aim.slot.empty())
+		aim.slot.assign(AimCache::angles()*AimCache::heights(),-1);
+	if(aim.slot[c]>=0)
+		return aim.slot[c];
+	bulletshape b;
+	float a=AimCache::cell_angle(c)*M_PI/180.0f;
+	tracepath(b,-4.68,AimCache::cell_height(c),cos(a),sin(a),0,-1);
+	aimpath p;
+	p.n=b.segs+1;
+	for(int k=0;k<b.segs;k++){
+		p.x[k]=b.path[k].x;
+		p.y[k]=b.path[k].y;
+	}
+	const pathseg &last=b.path[b.segs-1];
+	p.x[b.segs]=last.x+(b.path_end-last.s)*last.dirx;
+	p.y[b.segs]=last.y+(b.path_end-last.s)*last.diry;
+	//paths dropped by movemirrors() leave gaps; start over before the
+	//table holds more paths than it has cells
+	if(aim.paths.size()>=aim.slot.size())
+		aim.clear();
+	aim.slot[c]=aim.paths.size();
+	aim.paths.push_back(p);
+	aim.cell_of.push_back(c);
+	return aim.slot[c];
+}
+
+/* Whether the player is turning or moving the canon, which is when the
+   aim preview is shown */
+int World::aiming() const
+{
+	const velocity &v=players.vel(PLAYER_CANON);
+	return v.spin!=0 || v.vy!=0 || m_canon;
+}
+
+/* Put every brick into the grid; from then on createbricks() and
+   removebrick() keep it up to date */
+void World::buildgrid()
+{
+	grid.clear(GRID_CELL);
+	for(int i=0;i<brick.count;i++){
+		float x0,y0,x1,y1;
+		gridbox(brick.id[i],x0,y0,x1,y1);
+		grid.insert(brick.id[i],x0,y0,x1,y1);
+	}
+	grid_live=1;
+}
+
+/* Box of brick id in the grid. A brick spawned when the field had fallen
+   key is at trans fallen-key, so it spans y+fallen in [4.55+key,4.95+key]
+   whatever the time; widened a little as brick.trans is accumulated in
+   float. Queries add fallen to their y to match. */
+void World::gridbox(int id,float &x0,float &y0,float &x1,float &y1) const
+{
+	double key=lanes.key[id];
+	x0=brick.x[brick.index[id]]-0.1f;
+	x1=brick.x[brick.index[id]]+0.1f;
+	y0=4.55+key-1e-3;
+	y1=4.95+key+1e-3;
+}
+
+/* Remember where everything was before this tick so the renderer can
+   draw positions between two ticks */
+void World::save_prev()
+{
+	save_prev_players();
+	for(int var=0;var<brick.count;var++)
+		brick.prev[var]=brick.trans[var];
+	for(int var=0;var<bullet.count;var++){
+		bullet.b[var].prevx=bullet.b[var].newx;
+		bullet.b[var].prevy=bullet.b[var].newy;
+	}
+}
+
+void World::save_prev_players()
+{
+	players.each(COMP_TRANSFORM|COMP_PREV,[](Archetype &a){
+		a.prev=a.xf;
+	});
+}
+
+/* Offset of basket e a fraction t of the way through the current tick */
+static inline float basket_at(const EntityStore &players,int e,float t)
+{
+	float x0=players.prev(e).x,x1=players.xf(e).x;
+	return x0+(x1-x0)*t;
+}
+
+/* Score the brick at dense index i landing a fraction at of the way
+   through the tick and remove it. Returns 1 if that ends the game. */
+int World::catchbrick(int i,float at)
+{
+	float bx=brick.x[i];
+	int color=brick.color[i];
+	float red=-1+basket_at(players,PLAYER_RED,at),green=1+basket_at(players,PLAYER_GREEN,at);
+	//a brick scores when the basket of its colour is under it and apart
+	//from the other one; black bricks go in neither
+	for(int e=PLAYER_RED;e<=PLAYER_GREEN;e++){
+		if(players.colour(e)!=color)
+			continue;
+		float x=e==PLAYER_RED ? red : green;
+		if(fabs(red-green)<=0.35)
+			score--;
+		else if(x<=bx+0.25 && x>=bx-0.25)
+			score++;
+		else
+			score--;
+	}
+	removebrick(i);
+	if(!quiet)
+		printf("Score: %d\n",score);
+	if(color==0 && !endless)
+	{
+		if(!quiet){
+			printf("\n GAMEOVER \n");
+			printf("Score: %d \n",score);
+		}
+		gameover=1;
+		return 1;
+	}
+	return 0;
+}
+
+/* Ticks until the given number of seconds have passed, at least one. The
+   small allowance keeps 2 s at 120 Hz at 240 ticks despite rounding. */
+int World::ticks_for(float seconds) const
+{
+	int n=ceil(seconds/tick_dt-1e-3);
+	return n>0 ? n : 1;
+}
+
+/* First tick that ends at or after t seconds into the game */
+unsigned int World::tick_at(double t) const
+{
+	double n=ceil(t/tick_dt-1e-3);
+	return n>0 ? (unsigned int)n : 0;
+}
+
+/* Start the periodic timers; runs on the first tick so settings made
+   after init() and the real tick length are both known */
+void World::start_timers()
+{
+	timers.add(ticks_for(spawn_interval),TIMER_SPAWN);
+	timers.add(ticks_for(fire_interval),TIMER_FIRE);
+	if(level && level->has_next)
+		timers.add(tick_at(level->next.t),TIMER_LEVEL);
+}
+
+/* Run the timers due on this tick */
+void World::run_timers()
+{
+	timers.advance(tick,[&](int kind){
+		switch(kind){
+			case TIMER_SPAWN:
+				for(int i=0;i<spawn_count;i++)
+					randombricks();
+				timers.add(tick+ticks_for(spawn_interval),TIMER_SPAWN);
+				break;
+			case TIMER_FIRE:
+				fire_ready=1;
+				break;
+			case TIMER_MOUSE:
+				mouse_ready=1;
+				break;
+			case TIMER_LEVEL:
+				level->advance(*this);
+				if(level->has_next)
+					timers.add(tick_at(level->next.t),TIMER_LEVEL);
+				break;
+		}
+	});
+}
+
+/* Fire while the key is held, once per fire_interval */
+void World::fire()
+{
+	if(fire_ready && spaceflag==1){
+		fire_ready=0;
+		timers.add(tick+ticks_for(fire_interval),TIMER_FIRE);
+		for(int i=0;i<fire_count;i++)
+			createbullets(players.xf(PLAYER_CANON).rot);
+	}
+}
+
+void World::movebaskets(float dt)
+{
+	xform &red=players.xf(PLAYER_RED),&green=players.xf(PLAYER_GREEN);
+	float redbasket_trans_check=red.x+players.vel(PLAYER_RED).vx*dt;
+	if(redbasket_trans_check<5.5 && redbasket_trans_check>-1.75)
+	{
+		red.x=redbasket_trans_check;
+	}
+	float greenbasket_trans_check=green.x+players.vel(PLAYER_GREEN).vx*dt;
+	if(greenbasket_trans_check<3.5 && greenbasket_trans_check>-3.75)
+	{
+		green.x=greenbasket_trans_check;
+	}
+}
+
+/* Laser, canon and view; nothing here touches bricks or bullets */
+void World::moveplayer(float dt)
+{
+	xform &laser=players.xf(PLAYER_LASER);
+	float laser_trans_check=laser.x+players.vel(PLAYER_LASER).vx*dt;
+	if(laser_trans_check<9.0)
+	{
+		laser.x=laser_trans_check;
+	}
+	else
+	{
+		laser.x=0;
+		players.vel(PLAYER_LASER).vx=0;
+	}
+
+	// Increment angles
+	xform &canon=players.xf(PLAYER_CANON);
+	const velocity &v=players.vel(PLAYER_CANON);
+	float rectangle_rot_check=canon.rot + v.spin*dt;
+	if(rectangle_rot_check<60 && rectangle_rot_check>-60)
+	{
+		canon.rot=rectangle_rot_check;
+	}
+	float canon_trans_check=canon.y+v.vy*dt;
+	if(canon_trans_check<3.5 && canon_trans_check>-3.5)
+	{
+		canon.y=canon_trans_check;
+	}
+	//mousepan
+	if(m_flag && zoom>0){
+		pan-=(mouse_click_x - mouse_xpos);
+		mouse_click_x=mouse_xpos;
+		clamp_pan();
+	}
+}
+
+/* Call f(i) for i in [0,n) on the pool, grain at a time, and collect the
+   i for which it returns true into flagged, in order */
+template<class F> void World::sweep(int n,int grain,F f)
+{
+	static ThreadPool serial;
+	ThreadPool &p=pool ? *pool : serial;
+	flag.resize(n);
+	chunk_flagged.resize(ThreadPool::chunks_for(n,grain));
+	p.parallel_for(n,grain,[&](int c,int begin,int end){
+		std::vector<int> &out=chunk_flagged[c];
+		out.clear();
+		for(int i=begin;i<end;i++)
+			if((flag[i]=f(i)))
+				out.push_back(i);
+	});
+	flagged.clear();
+	for(size_t c=0;c<chunk_flagged.size();c++)
+		flagged.insert(flagged.end(),chunk_flagged[c].begin(),chunk_flagged[c].end());
+}
+
+/* Remove the items sweep() flagged the way a front to back loop would:
+   remove(i) drops item i and moves the last item into its place, so that
+   item is looked at next. Stops and returns 1 when remove() does. */
+template<class R> int World::remove_flagged(int &count,R remove)
+{
+	for(size_t k=0;k<flagged.size() && flagged[k]<count;k++){
+		int i=flagged[k];
+		while(i<count && flag[i]){
+			int last=count-1;
+			flag[i]=flag[last];
+			flag[last]=0;
+			if(remove(i))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/* Advance the simulation by dt seconds; called at a fixed rate of
+   TICK_RATE so game speed does not depend on the display */
+void World::step(float dt)
+{
+	if(gameover)
+		return;
+	tick_dt=dt;
+	if(tick==0)
+		start_timers();
+	if(event_driven){
+		step_events(dt);
+		return;
+	}
+	save_prev();
+	tick++;
+	time+=dt;
+
+	//***BRICKS***
+	run_timers();
+	//baskets move before the catch test so it can see where they were
+	//at any moment of the tick
+	movebaskets(dt);
+	float fall=brick_speed*dt;
+	fallen+=fall;
+	sweep(brick.count,BRICK_GRAIN,[&](int i){
+		brick.trans[i]+=fall;
+		return 4.75-brick.trans[i]<-3.9;
+	});
+	if(remove_flagged(brick.count,[&](int i){
+		//baskets where the brick crossed the catch line, not where they
+		//are at the end of the tick; trans 8.65 puts the brick at -3.9
+		float p=brick.prev[i],c=brick.trans[i];
+		float at=c>p ? (8.65f-p)/(c-p) : 1;
+		if(at<0)
+			at=0;
+		return catchbrick(i,at);
+	}))
+		return;
+
+	//BULLETS
+	movemirrors(dt,time);
+	fire();
+	if(broadphase==BROADPHASE_GRID && !grid_live)
+		buildgrid();
+	sweep(bullet.count,BULLET_GRAIN,[&](int i){
+		bulletshape &b=bullet.b[i];
+		movebullet(b);
+		b.dist+=BULLET_SPEED*dt;
+		return b.newx>FIELD_EDGE || b.newx<-FIELD_EDGE || b.newy>FIELD_EDGE || b.newy<-FIELD_EDGE;
+	});
+	remove_flagged(bullet.count,[&](int i){
+		bullet.remove(i);
+		return 0;
+	});
+	checkcollision();
+	moveplayer(dt);
+}
@@ -0,0 +1,284 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "rng.h"
+#include "bricks.h"
+#include "bullets.h"
+#include "lanes.h"
+#include "grid.h"
+#include "events.h"
+#include "timers.h"
+#include "bvh.h"
+#include "aim.h"
+#include "ecs.h"
+#include "pool.h"
+
+/* Game simulation state. Nothing in here may depend on GL or GLFW so the
+   simulation can be stepped on machines without a display. */
+
+/* Key, button and action codes use the same values as GLFW so the window
+   callbacks can forward their arguments unchanged */
+enum {
+	ACTION_RELEASE=0,
+	ACTION_PRESS=1,
+
+	KEY_SPACE=32,
+	KEY_A=65,
+	KEY_D=68,
+	KEY_F=70,
+	KEY_M=77,
+	KEY_N=78,
+	KEY_S=83,
+	KEY_ESCAPE=256,
+	KEY_RIGHT=262,
+	KEY_LEFT=263,
+	KEY_DOWN=264,
+	KEY_UP=265,
+	KEY_RIGHT_CONTROL=345,
+	KEY_RIGHT_ALT=346,
+
+	MOUSE_BUTTON_LEFT=0,
+	MOUSE_BUTTON_RIGHT=1
+};
+
+/* Speeds are per second; the original game moved these amounts every
+   frame at 60 frames per second */
+#define BRICK_SPEED 1.8f
+#define BULLET_SPEED 9.6f
+#define MOVE_SPEED 1.8f
+#define CANON_ROT_SPEED 60.0f
+#define LASER_SPEED 6.0f
+
+/* Bullets are removed once their centre passes this in x or y */
+#define FIELD_EDGE 4.8
+
+/* Meshes the renderer draws the canon, baskets and mirrors with */
+#define MESH_CANON 0
+#define MESH_RED_BASKET 1
+#define MESH_GREEN_BASKET 2
+#define MESH_MIRROR 3
+
+/* Entity ids in World::players; init() creates them in this order */
+enum {
+	PLAYER_CANON=0,
+	PLAYER_RED,	//red basket
+	PLAYER_GREEN,	//green basket
+	PLAYER_LASER
+};
+
+/* Moving mirrors keep their centres within this distance of the middle */
+#define MIRROR_RANGE 4.0f
+
+/* Bricks spawn at whole x from SPAWN_MIN, in SPAWN_LANES lanes */
+#define SPAWN_MIN -3
+#define SPAWN_LANES 8
+
+/* Items per chunk when a tick's per-brick and per-bullet work is split
+   across World::pool */
+#define BRICK_GRAIN 8192
+#define BULLET_GRAIN 256
+
+/* Simulation ticks per second; the renderer interpolates between ticks */
+#define TICK_RATE 120
+
+/* How checkcollision() finds bricks near a bullet; mirrors always go
+   through World::mirror_bvh */
+enum {
+	BROADPHASE_BRUTE=0,	//every bullet against every brick
+	BROADPHASE_LANES,	//only bricks in the bullet's lanes near its height
+	BROADPHASE_GRID		//spatial hash grid of bricks at any position
+};
+
+#define GRID_CELL 0.5f
+
+/* What a timer on World::timers does when it comes due */
+enum {
+	TIMER_SPAWN=0,	//spawn bricks and start the next spawn timer
+	TIMER_FIRE,	//fire key cooldown over
+	TIMER_MOUSE,	//mouse fire cooldown over
+	TIMER_LEVEL	//next timed entry of the level file is due
+};
+
+struct Level;
+
+/* A brick shot in checkcollision(): its dense index, the index of the
+   last brick that moved into its place and where that brick is */
+typedef struct shot{
+	int i;
+	int last;
+	float x;
+	float trans;
+}shot;
+
+float crossing(const collider &m,float ax,float ay,float bx,float by);
+
+struct World {
+	//canon, baskets and laser, ids PLAYER_*. Transforms are offsets from
+	//where their meshes are drawn at rest: the canon's height and angle,
+	//the baskets' and laser's x. Baskets have the colour they catch.
+	EntityStore players;
+	//mirrors are entities with a transform, segment collider and mesh, plus
+	//a velocity if they move; entity ids are mirror numbers
+	EntityStore mirrors;
+	//every ray and segment query against the mirrors goes through this;
+	//rebuilt by buildmirrors() when mirrors are added and refitted by
+	//movemirrors() when they move
+	SegmentBVH mirror_bvh;
+	//area each mirror that moved this tick swept, widened by a bullet tip,
+	//and a BVH over them; only paths crossing one are traced again
+	std::vector<bvhbox> swept;
+	SegmentBVH swept_bvh;
+	//aim preview paths, emptied by buildmirrors() and thinned by
+	//movemirrors()
+	AimCache aim;
+	//x of every spawn lane no mirror lies across, and how many mirrors lie
+	//across each lane
+	std::vector<int> spawn_lanes;
+	int lane_blockers[SPAWN_LANES];
+	BulletPool bullet;
+	BrickPool brick;
+	LaneIndex lanes;
+	//total distance bricks have fallen since the game started
+	double fallen;
+	int broadphase;
+	//bricks by id for BROADPHASE_GRID, built by buildgrid() the first
+	//time it is needed and then kept up as bricks come and go. Bricks all
+	//fall alike, so each is listed where it spawned: y+fallen is what
+	//stays fixed (see gridbox()).
+	SpatialGrid grid;
+	int grid_live;
+	//brick spawning draws only from this generator
+	Rng rng;
+	uint64_t seed;
+	float brick_speed;
+	//seconds between spawns and bricks per spawn
+	float spawn_interval;
+	int spawn_count;
+	//colours spawned bricks are picked from, a bit per colour
+	int spawn_colours;
+	//seconds between shots while fire is held and bullets per shot
+	float fire_interval;
+	int fire_count;
+	int score,wrong;
+
+	//simulation clock; periodic work runs off the timer wheel
+	unsigned int tick;
+	double time;
+	TimerWheel timers;
+	//length of the last tick, for turning seconds into ticks
+	float tick_dt;
+	//set when the fire key and mouse cooldowns have run out
+	int fire_ready,mouse_ready;
+	//level file feeding timed entries in, or NULL; set by Level::start()
+	Level *level;
+
+	//input state
+	int rightkey,leftkey,rightctrl,rightalt;
+	int spaceflag;
+	int m_redbasket,m_greenbasket,m_canon,m_flag;
+	double mouse_xpos,mouse_ypos,mouse_click_x;
+
+	//view state, only read by the renderer
+	int zoom;
+	float pan;
+
+	//counters the renderer watches to play sounds
+	int shots;
+	//0:running 1:black brick missed 2:too many wrong hits 3:quit
+	int gameover;
+	//suppress score printing (headless runs)
+	int quiet;
+	//missed black bricks and wrong hits never end the game (stress runs)
+	int endless;
+
+	//threads for the per-brick and per-bullet loops of a tick, or NULL to
+	//run them on the calling thread; results never depend on it
+	ThreadPool *pool;
+	//scratch for those loops: per-entity flags and results, flagged
+	//indices per chunk, and bricks shot so far in checkcollision()
+	std::vector<char> flag;
+	std::vector<int> flagged,hit;
+	std::vector<std::vector<int> > chunk_flagged;
+	std::vector<shot> shots_this_tick;
+
+	//event-driven mode: bricks and bullets move in closed form and only
+	//the predicted events in this queue touch them
+	int event_driven;
+	EventQueue events;
+	uint32_t epoch;
+	//brick speed the queued events were predicted with
+	float planned_speed;
+	//bullets by the lanes their planned window sweeps and by the brick id
+	//they are set to hit, so a new or removed brick only looks at the
+	//bullets it can affect; stale entries are dropped as lists are read
+	std::vector<lanebullet> lane_bullets[LANE_COUNT];
+	size_t lane_pruned[LANE_COUNT];
+	std::vector<std::vector<uint32_t> > targeted;
+	std::vector<int> affected,leaders;
+
+	void init(uint64_t seed);
+	void step(float dt);
+	void save_prev();
+	void save_prev_players();
+
+	void key(int key,int action,int mods);
+	void keychar(unsigned int key);
+	void mouse_button(int button,int action,int mods);
+	void cursor(double x,double y);
+	void scroll(double xoffset,double yoffset);
+
+	uint32_t createbullets(float angle);
+	void createbricks(float x,int color);
+	void removebrick(int i);
+	void randombricks();
+	void buildgrid();
+	void gridbox(int id,float &x0,float &y0,float &x1,float &y1) const;
+	void checkcollision();
+	int firsthit(const bulletshape &b) const;
+	template<class F> void sweep(int n,int grain,F f);
+	template<class R> int remove_flagged(int &count,R remove);
+	void addmirror(float x,float y,float rot,float vx=0,float vy=0,float spin=0);
+	void buildmirrors();
+	void movemirrors(float dt,double now);
+	int crosses_swept(float ax,float ay,float bx,float by) const;
+	int path_crosses(const bulletshape &b,double now) const;
+	int mirror_lanes(const collider &m) const;
+	void setlanes();
+	void retrace(int j,double now);
+	int load_mirrors(const char *path);
+	int firstmirror(float ax,float ay,float bx,float by,int skip,float &t) const;
+	void tracepath(bulletshape &b,float x,float y,float dirx,float diry,float s,int skip) const;
+	void nextseg(bulletshape &b) const;
+	float segend(const bulletshape &b) const;
+	void movebullet(bulletshape &b);
+	int aimpreview(float angle,float height);
+	int aiming() const;
+	void shootbrick(int i);
+	int catchbrick(int i,float at);
+	int ticks_for(float seconds) const;
+	unsigned int tick_at(double t) const;
+	void start_timers();
+	void run_timers();
+	void fire();
+	void movebaskets(float dt);
+	void moveplayer(float dt);
+
+	//event-driven mode, events.cpp
+	void step_events(float dt);
+	void run_events(double until);
+	void replan(double now);
+	void plan_brick(int i);
+	void plan_bullet(int j,double now,int like=-1);
+	void newbrick(int i);
+	void retarget(int id,double now);
+	void settarget(int j,int id);
+	void prune_lane(int l);
+	double hit_time(const bulletshape &b,int i,double now,double horizon) const;
+	void sync();
+	void clamp_pan();
+};
+
+#endif